@@ -14,14 +14,29 @@
 
 #include <kth/domain.hpp>
 #include <kth/network/acceptor.hpp>
+#include <kth/network/address_blacklist.hpp>
+#include <kth/network/address_manager.hpp>
+#include <kth/network/block_stream.hpp>
 #include <kth/network/channel.hpp>
+#include <kth/network/channel_index.hpp>
+#include <kth/network/connection_slots.hpp>
+#include <kth/network/connection_statistics.hpp>
 #include <kth/network/connector.hpp>
 #include <kth/network/define.hpp>
+#include <kth/network/handler_memory.hpp>
 #include <kth/network/hosts.hpp>
+#include <kth/network/inbound_admission.hpp>
+#include <kth/network/message_metrics.hpp>
 #include <kth/network/message_subscriber.hpp>
 #include <kth/network/p2p.hpp>
+#include <kth/network/parse_backlog.hpp>
+#include <kth/network/payload_buffer.hpp>
+#include <kth/network/payload_pool.hpp>
 #include <kth/network/proxy.hpp>
+#include <kth/network/send_queue.hpp>
 #include <kth/network/settings.hpp>
+#include <kth/network/statistics_server.hpp>
+#include <kth/network/token_bucket.hpp>
 #include <kth/network/version.hpp>
 #include <kth/network/protocols/protocol.hpp>
 #include <kth/network/protocols/protocol_address_31402.hpp>
@@ -25,6 +25,7 @@ class BCT_API acceptor
 public:
     using ptr = std::shared_ptr<acceptor>;
     using accept_handler = std::function<void(code const&, channel::ptr)>;
+    using admission_handler = std::function<code(infrastructure::config::authority const&)>;
 
     /// Construct an instance.
     acceptor(threadpool& pool, settings const& settings);
@@ -38,13 +39,18 @@ public:
     /// Accept the next connection available, until canceled.
     virtual void accept(accept_handler handler);
 
+    /// Accept the next connection admitted by the admission handler, until
+    /// canceled. Connections are admitted before a channel is constructed,
+    /// a rejected connection is closed and the next is accepted.
+    virtual void accept(admission_handler admit, accept_handler handler);
+
     /// Cancel outstanding accept attempt.
     virtual void stop(code const& ec);
 
 private:
     virtual bool stopped() const;
 
-    void handle_accept(boost_code const& ec, socket::ptr socket, accept_handler handler);
+    void handle_accept(boost_code const& ec, socket::ptr socket, admission_handler admit, accept_handler handler);
 
     // These are thread safe.
     std::atomic<bool> stopped_;
@@ -0,0 +1,62 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_ADDRESS_BLACKLIST_HPP
+#define KTH_NETWORK_ADDRESS_BLACKLIST_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// This class is thread safe.
+/// Blocked address ranges (CIDR blocks, IPv4 as IPv4-mapped IPv6), merged
+/// into sorted disjoint ranges so that a lookup is a binary search. The
+/// ranges are replaced as a whole, so they can be reloaded while in use.
+class BCT_API address_blacklist : noncopyable {
+public:
+    using ip_address = domain::message::ip_address;
+
+    /// An inclusive range of addresses.
+    struct range {
+        ip_address first;
+        ip_address last;
+    };
+
+    using ranges = std::vector<range>;
+
+    /// Parse an address or CIDR block, such as 10.0.0.0/8 or 2001:db8::/32.
+    static bool parse(std::string const& text, range& out);
+
+    /// The range of a single address.
+    static range single(ip_address const& ip);
+
+    address_blacklist();
+
+    /// Replace the blocked ranges.
+    void assign(ranges values);
+
+    /// Read ranges from a file, one per line, blank lines and '#' comments
+    /// ignored. Returns error::file_system if the file cannot be read, or
+    /// error::bad_stream if a line is malformed (values is then incomplete).
+    static code read(kth::path const& file, ranges& values);
+
+    bool blocked(ip_address const& ip) const;
+
+    /// The number of disjoint ranges.
+    size_t size() const;
+
+private:
+    using table = std::shared_ptr<ranges const>;
+
+    kth::atomic<table> table_;
+};
+
+} // namespace kth::network
+
+#endif
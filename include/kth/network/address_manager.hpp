@@ -0,0 +1,123 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_ADDRESS_MANAGER_HPP
+#define KTH_NETWORK_ADDRESS_MANAGER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// This class is not thread safe.
+/// Bucketed store of network addresses split into "new" (heard of) and
+/// "tried" (connected to at least once) tables. New addresses are placed in
+/// a bucket derived from the netgroup of the address and of the peer that
+/// relayed it, so that a single source cannot displace the whole table.
+/// Selection favors tried addresses and penalizes repeated failures.
+class BCT_API address_manager : noncopyable {
+public:
+    using address = domain::message::network_address;
+
+    /// Identity of an address is its (ip, port) pair, services and time ignored.
+    struct address_hash {
+        size_t operator()(address const& host) const;
+    };
+
+    struct address_equal {
+        bool operator()(address const& left, address const& right) const;
+    };
+
+    /// Connection history of a stored address.
+    struct entry {
+        address host;
+        uint64_t source_group;
+        uint32_t last_success;
+        uint32_t last_attempt;
+        uint32_t failures;
+        bool tried;
+    };
+
+    using entries = std::vector<entry>;
+
+    /// The netgroup of an ip (/16 for IPv4, /32 for IPv6).
+    static uint64_t netgroup(domain::message::ip_address const& ip);
+
+    /// Construct an instance bounded to the specified number of addresses.
+    address_manager(size_t capacity);
+
+    size_t size() const;
+    size_t tried_size() const;
+    bool empty() const;
+    bool exists(address const& host) const;
+
+    /// Add an address to the new table, false if already present or evicted.
+    bool add(address const& host, address const& source);
+
+    /// Restore an address along with its history (used when loading).
+    bool restore(entry const& value);
+
+    /// Remove an address from either table.
+    bool remove(address const& host);
+
+    /// Record a connection attempt, counted as a failure until good.
+    void attempt(address const& host, uint32_t now);
+
+    /// Record a successful connection, moving the address to tried.
+    void good(address const& host, uint32_t now);
+
+    /// Select an address, biased toward tried and rarely failing entries.
+    bool select(address& out, uint32_t now) const;
+
+    /// Copy up to count addresses, tried first.
+    void copy(address::list& out, size_t count) const;
+
+    /// Copy all entries along with their history.
+    entries snapshot() const;
+
+    void clear();
+
+private:
+    struct record {
+        entry value;
+        size_t bucket;
+        size_t position;
+    };
+
+    using records = std::unordered_map<address, record, address_hash, address_equal>;
+    using table = std::vector<address>;
+    using buckets = std::vector<table>;
+
+    size_t new_bucket(address const& host, uint64_t source_group) const;
+    size_t tried_bucket(address const& host) const;
+
+    void insert(entry const& value);
+    void erase(records::iterator it);
+    void demote(address const& host);
+    table::const_iterator victim(table const& bucket) const;
+
+    table& list(bool tried);
+    buckets& slots(bool tried);
+
+    static uint32_t chance(entry const& value, uint32_t now);
+
+    size_t const bucket_size_;
+    size_t const new_buckets_;
+    size_t const tried_buckets_;
+    size_t const key_;
+
+    records records_;
+    table new_;
+    table tried_;
+    buckets new_slots_;
+    buckets tried_slots_;
+};
+
+} // namespace kth::network
+
+#endif
@@ -0,0 +1,98 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_BLOCK_STREAM_HPP
+#define KTH_NETWORK_BLOCK_STREAM_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// This class is not thread safe.
+/// Decodes a block payload while it is being read. Each update decodes the
+/// header and then every transaction whose bytes have fully arrived, so that
+/// little parsing remains once the last byte of a large block is read.
+/// Transactions are scanned in the legacy serialization, so a block with
+/// witness data is not decoded (blocks are only streamed for BCH).
+class BCT_API block_stream {
+public:
+    /// A block decoded by the stream, with the time spent decoding it.
+    struct result {
+        domain::message::block block;
+        std::chrono::nanoseconds parse_time;
+    };
+
+    using result_ptr = std::shared_ptr<result>;
+
+    block_stream();
+
+    /// True from start until finish or reset.
+    bool active() const;
+
+    /// Begin decoding a block payload of the specified size.
+    void start(size_t payload_size);
+
+    /// Decode what is complete of the first size bytes of the payload.
+    /// Returns false if the bytes do not form a valid block.
+    bool update(data_chunk const& payload, size_t size);
+
+    /// The decoded block once the whole payload has been updated, or null if
+    /// the block is incomplete or has trailing bytes. Resets the stream.
+    result_ptr finish();
+
+    void reset();
+
+private:
+    // The serialized fields of a transaction, in order.
+    enum class field {
+        version,
+        input_count,
+        previous_output,
+        input_script_size,
+        input_script,
+        sequence,
+        output_count,
+        value,
+        output_script_size,
+        output_script,
+        locktime,
+        complete
+    };
+
+    // Progress of the size scan of the transaction being read, so that a
+    // transaction arriving over many reads is scanned once.
+    struct scan_state {
+        field next;
+        size_t size;
+        uint64_t remaining;
+        uint64_t script;
+    };
+
+    enum class scan_result {
+        incomplete,
+        complete,
+        invalid
+    };
+
+    static scan_result scan(scan_state& state, uint8_t const* begin, uint8_t const* end, size_t limit);
+
+    bool active_;
+    size_t payload_size_;
+    size_t position_;
+    std::optional<domain::chain::header> header_;
+    std::optional<uint64_t> count_;
+    domain::chain::transaction::list transactions_;
+    scan_state scan_;
+    std::chrono::nanoseconds parse_time_;
+};
+
+} // namespace kth::network
+
+#endif
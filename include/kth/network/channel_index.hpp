@@ -0,0 +1,153 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_CHANNEL_INDEX_HPP
+#define KTH_NETWORK_CHANNEL_INDEX_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <kth/domain.hpp>
+#include <kth/network/channel.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// Hash of an authority by ip and port.
+struct BCT_API authority_hash {
+    size_t operator()(infrastructure::config::authority const& authority) const;
+};
+
+/// This class is thread safe.
+/// Channels indexed by a unique key, such as the authority or version nonce.
+/// The index is split into independently locked shards, so that concurrent
+/// accepts and handshakes rarely contend and a lookup does not scan.
+template <typename Key, typename Hash = std::hash<Key>>
+class channel_index : noncopyable {
+public:
+    using key_function = Key (*)(channel::ptr const&);
+    using list = std::vector<channel::ptr>;
+
+    explicit
+    channel_index(key_function key)
+        : key_(key), stopped_(false), size_(0)
+    {}
+
+    /// Store the channel, error::address_in_use if its key is present.
+    code store(channel::ptr const& channel) {
+        auto const key = key_(channel);
+        auto& shard = shard_of(key);
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<upgrade_mutex> lock(shard.mutex);
+
+        if (stopped_) {
+            return error::service_stopped;
+        }
+
+        if ( ! shard.channels.emplace(key, channel).second) {
+            return error::address_in_use;
+        }
+
+        ++size_;
+        return error::success;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    /// Remove the channel, false if it is not stored.
+    bool remove(channel::ptr const& channel) {
+        auto const key = key_(channel);
+        auto& shard = shard_of(key);
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<upgrade_mutex> lock(shard.mutex);
+
+        auto const it = shard.channels.find(key);
+
+        // Another channel may hold the key (see store).
+        if (it == shard.channels.end() || it->second != channel) {
+            return false;
+        }
+
+        shard.channels.erase(it);
+        --size_;
+        return true;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    bool exists(Key const& key) const {
+        auto const& shard = shard_of(key);
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        shared_lock lock(shard.mutex);
+        return shard.channels.find(key) != shard.channels.end();
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    /// Copy the channels, shard by shard (not an atomic snapshot).
+    list collection() const {
+        list out;
+        out.reserve(size_);
+
+        for (auto const& shard: shards_) {
+            // Critical Section
+            ///////////////////////////////////////////////////////////////////
+            shared_lock lock(shard.mutex);
+
+            for (auto const& entry: shard.channels) {
+                out.push_back(entry.second);
+            }
+            ///////////////////////////////////////////////////////////////////
+        }
+
+        return out;
+    }
+
+    /// Stop all channels and reject further stores.
+    void stop(code const& ec) {
+        stopped_ = true;
+
+        // Channels remove themselves on stop, so they are stopped unlocked.
+        for (auto const& channel: collection()) {
+            channel->stop(ec);
+        }
+    }
+
+private:
+    static constexpr size_t shard_count = 16;
+
+    struct shard {
+        std::unordered_map<Key, channel::ptr, Hash> channels;
+        mutable upgrade_mutex mutex;
+    };
+
+    shard& shard_of(Key const& key) {
+        return shards_[Hash{}(key) % shard_count];
+    }
+
+    shard const& shard_of(Key const& key) const {
+        return shards_[Hash{}(key) % shard_count];
+    }
+
+    key_function const key_;
+    std::atomic<bool> stopped_;
+    std::atomic<size_t> size_;
+    std::array<shard, shard_count> shards_;
+};
+
+} // namespace kth::network
+
+#endif
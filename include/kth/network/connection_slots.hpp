@@ -0,0 +1,49 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_CONNECTION_SLOTS_HPP
+#define KTH_NETWORK_CONNECTION_SLOTS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// This class is thread safe.
+/// Counts connections by ip and by netgroup (see address_manager::netgroup),
+/// so that a single address or network cannot take every inbound slot.
+class BCT_API connection_slots : noncopyable {
+public:
+    using ip_address = domain::message::ip_address;
+
+    /// Construct with the slots allowed per ip and per netgroup, zero is unlimited.
+    connection_slots(size_t ip_limit, size_t group_limit);
+
+    /// Take a slot for the ip, false (taking nothing) if a limit is reached.
+    bool acquire(ip_address const& ip);
+
+    /// Return a slot taken by acquire.
+    void release(ip_address const& ip);
+
+private:
+    struct ip_hash {
+        size_t operator()(ip_address const& ip) const;
+    };
+
+    size_t const ip_limit_;
+    size_t const group_limit_;
+
+    // These are protected by mutex.
+    std::unordered_map<ip_address, size_t, ip_hash> ips_;
+    std::unordered_map<uint64_t, size_t> groups_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace kth::network
+
+#endif
@@ -0,0 +1,65 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_CONNECTION_STATISTICS_HPP
+#define KTH_NETWORK_CONNECTION_STATISTICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// The kind of session that established a channel.
+enum class session_kind {
+    seed,
+    manual,
+    inbound,
+    outbound
+};
+
+/// This class is thread safe.
+/// Outcomes of the connection attempts of one session kind, and a histogram
+/// of the time from channel start to completed handshake.
+class BCT_API connection_statistics : noncopyable {
+public:
+    /// Inclusive upper bounds of the handshake latency buckets.
+    static constexpr std::array<uint32_t, 8> bucket_milliseconds{ 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+
+    struct snapshot_type {
+        uint64_t succeeded;
+        uint64_t failed;
+
+        /// Non-cumulative counts, the last bucket is unbounded.
+        std::array<uint64_t, bucket_milliseconds.size() + 1> handshakes;
+        uint64_t handshake_milliseconds;
+    };
+
+    connection_statistics();
+
+    /// A channel was connected, handshaken and registered.
+    void succeeded();
+
+    /// A connection attempt or its handshake failed.
+    void failed();
+
+    /// A handshake completed after the specified time.
+    void handshake(std::chrono::milliseconds latency);
+
+    snapshot_type snapshot() const;
+
+private:
+    std::atomic<uint64_t> succeeded_;
+    std::atomic<uint64_t> failed_;
+    std::array<std::atomic<uint64_t>, bucket_milliseconds.size() + 1> handshakes_;
+    std::atomic<uint64_t> handshake_milliseconds_;
+};
+
+} // namespace kth::network
+
+#endif
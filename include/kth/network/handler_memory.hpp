@@ -0,0 +1,107 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_HANDLER_MEMORY_HPP
+#define KTH_NETWORK_HANDLER_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// This class is not thread safe.
+/// Storage for the asynchronous operation of a loop that has at most one
+/// operation outstanding, such as the read or the write cycle of a socket.
+/// Asio releases the memory of an operation before invoking its handler, so
+/// the next operation started by the handler reuses the same storage. An
+/// operation that does not fit, or overlaps another, uses the heap.
+class BCT_API handler_memory : noncopyable {
+public:
+    handler_memory();
+
+    void* allocate(size_t size);
+    void deallocate(void* pointer);
+
+    /// The number of allocations that did not reuse the storage.
+    size_t heap_allocations() const;
+
+private:
+    static constexpr size_t capacity = 1024;
+
+    alignas(std::max_align_t) uint8_t storage_[capacity];
+    bool in_use_;
+    size_t heap_allocations_;
+};
+
+/// Allocator associated with a recycled handler.
+template <typename Type>
+class handler_allocator {
+public:
+    using value_type = Type;
+
+    explicit
+    handler_allocator(handler_memory& memory)
+        : memory_(memory)
+    {}
+
+    template <typename Other>
+    handler_allocator(handler_allocator<Other> const& other) noexcept
+        : memory_(other.memory_)
+    {}
+
+    bool operator==(handler_allocator const& other) const noexcept {
+        return &memory_ == &other.memory_;
+    }
+
+    Type* allocate(size_t count) const {
+        return static_cast<Type*>(memory_.allocate(sizeof(Type) * count));
+    }
+
+    void deallocate(Type* pointer, size_t) const {
+        memory_.deallocate(pointer);
+    }
+
+private:
+    template <typename>
+    friend class handler_allocator;
+
+    handler_memory& memory_;
+};
+
+/// Completion handler whose operation memory is taken from handler_memory.
+template <typename Handler>
+class recycled_handler {
+public:
+    using allocator_type = handler_allocator<Handler>;
+
+    recycled_handler(handler_memory& memory, Handler handler)
+        : memory_(memory), handler_(std::move(handler))
+    {}
+
+    allocator_type get_allocator() const noexcept {
+        return allocator_type(memory_);
+    }
+
+    template <typename... Args>
+    void operator()(Args&&... args) {
+        handler_(std::forward<Args>(args)...);
+    }
+
+private:
+    handler_memory& memory_;
+    Handler handler_;
+};
+
+template <typename Handler>
+recycled_handler<std::decay_t<Handler>> make_recycled_handler(handler_memory& memory, Handler&& handler) {
+    return { memory, std::forward<Handler>(handler) };
+}
+
+} // namespace kth::network
+
+#endif
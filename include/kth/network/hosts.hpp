@@ -7,10 +7,13 @@
 
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <kth/domain.hpp>
+#include <kth/network/address_manager.hpp>
 #include <kth/network/define.hpp>
 #include <kth/network/settings.hpp>
 
@@ -18,8 +21,11 @@ namespace kth::network {
 
 /// This class is thread safe.
 /// The hosts class manages a thread-safe dynamic store of network addresses.
+/// Addresses are kept in new/tried buckets along with their connection history.
 /// The store can be loaded and saved from/to the specified file path.
-/// The file is a line-oriented set of infrastructure::config::authority serializations.
+/// The file is a versioned binary image of the full addresses and their history,
+/// memory mapped on load and replaced atomically on save. Legacy files holding
+/// line-oriented infrastructure::config::authority serializations are also read.
 /// Duplicate addresses and those with zero-valued ports are disacarded.
 class BCT_API hosts : noncopyable {
 public:
@@ -30,33 +36,48 @@ public:
     /// Construct an instance.
     hosts(settings const& settings);
 
-    /// Load hosts file if found.
+    /// Load hosts file if found, an unreadable file is discarded.
     virtual code start();
 
     // Save hosts to file.
     virtual code stop();
 
+    /// Save a snapshot of the hosts to file without stopping.
+    virtual code checkpoint();
+
     virtual size_t count() const;
     virtual code fetch(address& out) const;
     virtual code fetch(address::list& out) const;
     virtual code remove(address const& host);
-    virtual code store(address const& host);
-    virtual void store(address::list const& hosts, result_handler handler);
+    /// Store addresses relayed by source, placed by the netgroup of source.
+    virtual code store(address const& host, address const& source);
+    virtual void store(address::list const& hosts, address const& source, result_handler handler);
 
-private:
-    using list = boost::circular_buffer<address>;
-    using iterator = list::iterator;
+    /// Record an outbound connection attempt to the address.
+    virtual code attempt(address const& host);
 
-    iterator find(address const& host);
+    /// Record a successful outbound connection to the address.
+    virtual code good(address const& host);
+
+private:
+    code load();
+    code load_legacy();
+    void discard() const;
+    code save(address_manager::entries const& entries, uint64_t generation) const;
 
     size_t const capacity_;
 
     // These are protected by a mutex.
-    list buffer_;
+    address_manager manager_;
     std::atomic<bool> stopped_;
+    std::atomic<uint64_t> snapshots_;
     mutable upgrade_mutex mutex_;
 
-    // HACK: we use this because the buffer capacity cannot be set to zero.
+    // This serializes file writes, it is never held with mutex_.
+    mutable uint64_t written_;
+    mutable std::mutex file_mutex_;
+
+    // A zero capacity disables the store entirely.
     bool const disabled_;
     kth::path const file_path_;
 };
@@ -0,0 +1,63 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_INBOUND_ADMISSION_HPP
+#define KTH_NETWORK_INBOUND_ADMISSION_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <kth/domain.hpp>
+#include <kth/network/connection_slots.hpp>
+#include <kth/network/define.hpp>
+#include <kth/network/token_bucket.hpp>
+
+namespace kth::network {
+
+/// This class is thread safe.
+/// Admission of inbound connections by address and netgroup slots, by
+/// handshakes in progress and by accept rate. The accept rate is consumed
+/// last, and a rejected connection returns what it took, so that connections
+/// rejected for their address cannot drain the accept rate of others.
+class BCT_API inbound_admission : noncopyable {
+public:
+    using ip_address = connection_slots::ip_address;
+
+    enum class result {
+        admitted,
+        address_limit,
+        handshake_limit,
+        rate_limit
+    };
+
+    /// Construct with the slots allowed per ip and per netgroup, handshakes
+    /// in progress, and accepts per second and burst, zero is unlimited.
+    inbound_admission(size_t ip_limit, size_t group_limit, size_t handshake_limit,
+        size_t rate, size_t burst);
+
+    /// Admit a connection from the ip, which takes a slot and a handshake.
+    result admit(ip_address const& ip);
+    result admit(ip_address const& ip, token_bucket::clock::time_point now);
+
+    /// Return the handshake taken by admit.
+    void end_handshake();
+
+    /// Return the slot taken by admit.
+    void release(ip_address const& ip);
+
+    /// Handshakes in progress.
+    size_t handshakes() const;
+
+private:
+    bool begin_handshake();
+
+    // These are thread safe.
+    connection_slots slots_;
+    token_bucket accepts_;
+    size_t const handshake_limit_;
+    std::atomic<size_t> handshakes_;
+};
+
+} // namespace kth::network
+
+#endif
@@ -0,0 +1,77 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_MESSAGE_METRICS_HPP
+#define KTH_NETWORK_MESSAGE_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+#include <kth/network/message_subscriber.hpp>
+
+namespace kth::network {
+
+/// Traffic totals of a single message type.
+struct BCT_API message_statistics {
+    uint64_t received;
+    uint64_t received_bytes;
+    uint64_t sent;
+    uint64_t sent_bytes;
+
+    /// Time spent parsing received messages, including inline handling.
+    uint64_t parse_nanoseconds;
+    uint64_t checksum_failures;
+
+    message_statistics& operator+=(message_statistics const& other);
+};
+
+/// This class is thread safe.
+/// Per message type traffic counters of a channel, updated without locking.
+/// Message types not in subscribable_messages are counted together as unknown.
+class BCT_API message_metrics : noncopyable {
+public:
+    static constexpr auto size = message_type_limit(subscribable_messages{});
+
+    /// Totals indexed by message type.
+    using table = std::array<message_statistics, size>;
+
+    /// The message type of a table index.
+    static domain::message::message_type type(size_t index);
+
+    /// The command of a table index, "unknown" if it has no message (such
+    /// indexes other than that of the unknown type are never counted).
+    static std::string command(size_t index);
+
+    message_metrics();
+
+    void received(domain::message::message_type type, size_t bytes, std::chrono::nanoseconds parse);
+    void sent(domain::message::message_type type, size_t bytes);
+    void checksum_failure(domain::message::message_type type);
+
+    /// Add the current counts to the table.
+    void accumulate(table& out) const;
+
+private:
+    struct counters {
+        std::atomic<uint64_t> received;
+        std::atomic<uint64_t> received_bytes;
+        std::atomic<uint64_t> sent;
+        std::atomic<uint64_t> sent_bytes;
+        std::atomic<uint64_t> parse_nanoseconds;
+        std::atomic<uint64_t> checksum_failures;
+    };
+
+    static size_t index(domain::message::message_type type);
+
+    std::array<counters, size> counters_;
+};
+
+} // namespace kth::network
+
+#endif
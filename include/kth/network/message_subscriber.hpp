@@ -5,75 +5,129 @@
 #ifndef KTH_NETWORK_MESSAGE_SUBSCRIBER_HPP
 #define KTH_NETWORK_MESSAGE_SUBSCRIBER_HPP
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <istream>
 #include <functional>
 #include <map>
 #include <memory>
 #include <utility>
 #include <string>
+#include <tuple>
 
 #include <kth/domain.hpp>
 #include <kth/infrastructure.hpp>
 
 #include <kth/network/define.hpp>
+#include <kth/network/settings.hpp>
+
 namespace kth::network {
 
-#define DEFINE_SUBSCRIBER_TYPE(value) \
-    using value##_subscriber_type = resubscriber<code, domain::message::value::const_ptr>
+template <typename Message>
+using message_handler = std::function<bool(code const&, std::shared_ptr<const Message>)>;
 
+/// Associates a stream message type identifier with its message class and
+/// its default dispatch mode (see dispatch_policy).
+template <domain::message::message_type Type, typename Message, bool Handle = false>
+struct message_entry {
+    static constexpr auto type = Type;
+    static constexpr bool handle = Handle;
+    using message = Message;
+};
 
-#define DEFINE_SUBSCRIBER_OVERLOAD(value) \
-    template <typename Handler> \
-    void subscribe(domain::message::value&&, Handler&& handler) { \
-        value##_subscriber_->subscribe(std::forward<Handler>(handler), \
-            error::channel_stopped, {}); \
-    }
+template <typename... Entries>
+struct message_list {};
 
-#define DECLARE_SUBSCRIBER(value) \
-    value##_subscriber_type::ptr value##_subscriber_
+/// The message types to which a channel may subscribe.
+using subscribable_messages = message_list<
+    message_entry<domain::message::message_type::address, domain::message::address>,
+    message_entry<domain::message::message_type::alert, domain::message::alert>,
+    message_entry<domain::message::message_type::block, domain::message::block, true>,
+    message_entry<domain::message::message_type::block_transactions, domain::message::block_transactions>,
+    message_entry<domain::message::message_type::compact_block, domain::message::compact_block>,
+    message_entry<domain::message::message_type::double_spend_proof, domain::message::double_spend_proof>,
+    message_entry<domain::message::message_type::fee_filter, domain::message::fee_filter>,
+    message_entry<domain::message::message_type::filter_add, domain::message::filter_add>,
+    message_entry<domain::message::message_type::filter_clear, domain::message::filter_clear>,
+    message_entry<domain::message::message_type::filter_load, domain::message::filter_load>,
+    message_entry<domain::message::message_type::get_address, domain::message::get_address>,
+    message_entry<domain::message::message_type::get_blocks, domain::message::get_blocks>,
+    message_entry<domain::message::message_type::get_block_transactions, domain::message::get_block_transactions>,
+    message_entry<domain::message::message_type::get_data, domain::message::get_data>,
+    message_entry<domain::message::message_type::get_headers, domain::message::get_headers>,
+    message_entry<domain::message::message_type::headers, domain::message::headers>,
+    message_entry<domain::message::message_type::inventory, domain::message::inventory>,
+    message_entry<domain::message::message_type::memory_pool, domain::message::memory_pool>,
+    message_entry<domain::message::message_type::merkle_block, domain::message::merkle_block>,
+    message_entry<domain::message::message_type::not_found, domain::message::not_found>,
+    message_entry<domain::message::message_type::ping, domain::message::ping>,
+    message_entry<domain::message::message_type::pong, domain::message::pong>,
+    message_entry<domain::message::message_type::reject, domain::message::reject>,
+    message_entry<domain::message::message_type::send_compact, domain::message::send_compact>,
+    message_entry<domain::message::message_type::send_headers, domain::message::send_headers>,
+    message_entry<domain::message::message_type::transaction, domain::message::transaction, true>,
+    message_entry<domain::message::message_type::verack, domain::message::verack, true>,
+    message_entry<domain::message::message_type::version, domain::message::version, true>,
+    message_entry<domain::message::message_type::xversion, domain::message::xversion, true>
+    // message_entry<domain::message::message_type::xverack, domain::message::xverack, true>
+>;
 
-template <typename Message>
-using message_handler = std::function<bool(code const&, std::shared_ptr<const Message>)>;
+/// One more than the greatest message type identifier in the list.
+template <typename... Entries>
+constexpr size_t message_type_limit(message_list<Entries...>) {
+    return std::max({ static_cast<size_t>(Entries::type)... }) + 1;
+}
+
+enum class dispatch_mode {
+    /// Notify subscribers on the threadpool.
+    relay,
+
+    /// Invoke subscribers on the reading thread, blocking the peer.
+    handle
+};
+
+/// Dispatch mode of each message type, thread safe.
+/// Modes may be changed at any time, for example to handle headers and
+/// inventory inline during initial block download.
+class BCT_API dispatch_policy : noncopyable {
+public:
+    using ptr = std::shared_ptr<dispatch_policy>;
+
+    /// Construct with the defaults of subscribable_messages.
+    dispatch_policy();
+
+    dispatch_mode mode(domain::message::message_type type) const;
+    void set_mode(domain::message::message_type type, dispatch_mode mode);
+
+private:
+    static constexpr auto limit = message_type_limit(subscribable_messages{});
+
+    std::array<std::atomic<dispatch_mode>, limit> modes_;
+};
 
 /// Aggregation of subscribers by messasge type, thread safe.
+/// The subscriber of a message type is created on first subscription, so the
+/// cost of a channel scales with the number of types actually subscribed.
 class BCT_API message_subscriber : noncopyable {
 public:
-    DEFINE_SUBSCRIBER_TYPE(address);
-    DEFINE_SUBSCRIBER_TYPE(alert);
-    DEFINE_SUBSCRIBER_TYPE(block);
-    DEFINE_SUBSCRIBER_TYPE(block_transactions);
-    DEFINE_SUBSCRIBER_TYPE(compact_block);
-    DEFINE_SUBSCRIBER_TYPE(double_spend_proof);
-    DEFINE_SUBSCRIBER_TYPE(fee_filter);
-    DEFINE_SUBSCRIBER_TYPE(filter_add);
-    DEFINE_SUBSCRIBER_TYPE(filter_clear);
-    DEFINE_SUBSCRIBER_TYPE(filter_load);
-    DEFINE_SUBSCRIBER_TYPE(get_address);
-    DEFINE_SUBSCRIBER_TYPE(get_blocks);
-    DEFINE_SUBSCRIBER_TYPE(get_block_transactions);
-    DEFINE_SUBSCRIBER_TYPE(get_data);
-    DEFINE_SUBSCRIBER_TYPE(get_headers);
-    DEFINE_SUBSCRIBER_TYPE(headers);
-    DEFINE_SUBSCRIBER_TYPE(inventory);
-    DEFINE_SUBSCRIBER_TYPE(memory_pool);
-    DEFINE_SUBSCRIBER_TYPE(merkle_block);
-    DEFINE_SUBSCRIBER_TYPE(not_found);
-    DEFINE_SUBSCRIBER_TYPE(ping);
-    DEFINE_SUBSCRIBER_TYPE(pong);
-    DEFINE_SUBSCRIBER_TYPE(reject);
-    DEFINE_SUBSCRIBER_TYPE(send_compact);
-    DEFINE_SUBSCRIBER_TYPE(send_headers);
-    DEFINE_SUBSCRIBER_TYPE(transaction);
-    DEFINE_SUBSCRIBER_TYPE(verack);
-    DEFINE_SUBSCRIBER_TYPE(version);
-    DEFINE_SUBSCRIBER_TYPE(xversion);
-    // DEFINE_SUBSCRIBER_TYPE(xverack);
+    template <typename Message>
+    using subscriber_type = resubscriber<code, typename Message::const_ptr>;
 
     /**
      * Create an instance of this class.
-     * @param[in]  pool  The threadpool to use for sending notifications.
+     * @param[in]  pool    The threadpool to use for sending notifications.
+     * @param[in]  policy  The treatment of messages without a subscriber.
      */
-    message_subscriber(threadpool& pool);
+    message_subscriber(threadpool& pool, unsubscribed_policy policy);
+
+    /**
+     * Set the dispatch modes shared with other channels.
+     * This is not thread safe and must be called before start.
+     * @param[in]  policy  The dispatch modes to apply to received messages.
+     */
+    void set_dispatch_policy(dispatch_policy::ptr policy);
 
     /**
      * Subscribe to receive a notification when a message of type is received.
@@ -83,7 +137,29 @@ public:
      */
     template <typename Message, typename Handler>
     void subscribe(Handler&& handler) {
-        subscribe(Message(), std::forward<Handler>(handler));
+        auto const subscriber = find_or_create<Message>();
+
+        // Subscription after stop is notified immediately, as by subscriber.
+        if ( ! subscriber) {
+            handler(error::channel_stopped, {});
+            return;
+        }
+
+        // The handler is live until it declines resubscription or is stopped.
+        auto& live = std::get<handler_count<Message>>(*handlers_).value;
+        auto const active = std::make_shared<std::atomic<bool>>(true);
+        message_handler<Message> const inner(std::forward<Handler>(handler));
+        ++live;
+
+        subscriber->subscribe([inner, active, handlers = handlers_](code const& ec, typename Message::const_ptr const& message) {
+            auto const resubscribe = inner(ec, message);
+
+            if ((ec || ! resubscribe) && active->exchange(false)) {
+                --std::get<handler_count<Message>>(*handlers).value;
+            }
+
+            return resubscribe;
+        }, error::channel_stopped, {});
     }
 
     /**
@@ -126,6 +202,33 @@ public:
         return error::success;
     }
 
+    /**
+     * Notify subscribers of a message already parsed by the caller.
+     * @param[in]  type     The stream message type identifier.
+     * @param[in]  message  The message instance.
+     * @return              Returns error::not_found if rejected as unsubscribed.
+     */
+    template <typename Message>
+    code notify(domain::message::message_type type, Message message) const {
+        auto const subscriber = find<Message>();
+
+        // The bytes have been consumed by the caller, so parse and skip agree.
+        if ( ! subscriber || ! has_handlers<Message>()) {
+            return unsubscribed_ == unsubscribed_policy::reject && ! handshake_message(type) ?
+                error::not_found : error::success;
+        }
+
+        auto const msg_ptr = std::make_shared<Message>(std::move(message));
+
+        if (dispatch_->mode(type) == dispatch_mode::handle) {
+            subscriber->invoke(error::success, msg_ptr);
+        } else {
+            subscriber->relay(error::success, msg_ptr);
+        }
+
+        return error::success;
+    }
+
 
     /**
      * Broadcast a default message instance with the specified error code.
@@ -155,72 +258,105 @@ public:
     virtual void stop();
 
 private:
-    DEFINE_SUBSCRIBER_OVERLOAD(address);
-    DEFINE_SUBSCRIBER_OVERLOAD(alert);
-    DEFINE_SUBSCRIBER_OVERLOAD(block);
-    DEFINE_SUBSCRIBER_OVERLOAD(block_transactions);
-    DEFINE_SUBSCRIBER_OVERLOAD(compact_block);
-    DEFINE_SUBSCRIBER_OVERLOAD(double_spend_proof);
-    DEFINE_SUBSCRIBER_OVERLOAD(fee_filter);
-    DEFINE_SUBSCRIBER_OVERLOAD(filter_add);
-    DEFINE_SUBSCRIBER_OVERLOAD(filter_clear);
-    DEFINE_SUBSCRIBER_OVERLOAD(filter_load);
-    DEFINE_SUBSCRIBER_OVERLOAD(get_address);
-    DEFINE_SUBSCRIBER_OVERLOAD(get_blocks);
-    DEFINE_SUBSCRIBER_OVERLOAD(get_block_transactions);
-    DEFINE_SUBSCRIBER_OVERLOAD(get_data);
-    DEFINE_SUBSCRIBER_OVERLOAD(get_headers);
-    DEFINE_SUBSCRIBER_OVERLOAD(headers);
-    DEFINE_SUBSCRIBER_OVERLOAD(inventory);
-    DEFINE_SUBSCRIBER_OVERLOAD(memory_pool);
-    DEFINE_SUBSCRIBER_OVERLOAD(merkle_block);
-    DEFINE_SUBSCRIBER_OVERLOAD(not_found);
-    DEFINE_SUBSCRIBER_OVERLOAD(ping);
-    DEFINE_SUBSCRIBER_OVERLOAD(pong);
-    DEFINE_SUBSCRIBER_OVERLOAD(reject);
-    DEFINE_SUBSCRIBER_OVERLOAD(send_compact);
-    DEFINE_SUBSCRIBER_OVERLOAD(send_headers);
-    DEFINE_SUBSCRIBER_OVERLOAD(transaction);
-    DEFINE_SUBSCRIBER_OVERLOAD(verack);
-    DEFINE_SUBSCRIBER_OVERLOAD(version);
-    DEFINE_SUBSCRIBER_OVERLOAD(xversion);
-    // DEFINE_SUBSCRIBER_OVERLOAD(xverack);
-
-    DECLARE_SUBSCRIBER(address);
-    DECLARE_SUBSCRIBER(alert);
-    DECLARE_SUBSCRIBER(block);
-    DECLARE_SUBSCRIBER(block_transactions);
-    DECLARE_SUBSCRIBER(compact_block);
-    DECLARE_SUBSCRIBER(double_spend_proof);
-    DECLARE_SUBSCRIBER(fee_filter);
-    DECLARE_SUBSCRIBER(filter_add);
-    DECLARE_SUBSCRIBER(filter_clear);
-    DECLARE_SUBSCRIBER(filter_load);
-    DECLARE_SUBSCRIBER(get_address);
-    DECLARE_SUBSCRIBER(get_blocks);
-    DECLARE_SUBSCRIBER(get_block_transactions);
-    DECLARE_SUBSCRIBER(get_data);
-    DECLARE_SUBSCRIBER(get_headers);
-    DECLARE_SUBSCRIBER(headers);
-    DECLARE_SUBSCRIBER(inventory);
-    DECLARE_SUBSCRIBER(memory_pool);
-    DECLARE_SUBSCRIBER(merkle_block);
-    DECLARE_SUBSCRIBER(not_found);
-    DECLARE_SUBSCRIBER(ping);
-    DECLARE_SUBSCRIBER(pong);
-    DECLARE_SUBSCRIBER(reject);
-    DECLARE_SUBSCRIBER(send_compact);
-    DECLARE_SUBSCRIBER(send_headers);
-    DECLARE_SUBSCRIBER(transaction);
-    DECLARE_SUBSCRIBER(verack);
-    DECLARE_SUBSCRIBER(version);
-    DECLARE_SUBSCRIBER(xversion);
-    // DECLARE_SUBSCRIBER(xverack);
-};
+    template <typename List>
+    struct subscriber_tuple;
+
+    template <typename... Entries>
+    struct subscriber_tuple<message_list<Entries...>> {
+        using type = std::tuple<typename subscriber_type<typename Entries::message>::ptr...>;
+    };
+
+    using subscribers = typename subscriber_tuple<subscribable_messages>::type;
+
+    template <typename Message>
+    struct handler_count {
+        std::atomic<size_t> value{0};
+    };
 
-#undef DEFINE_SUBSCRIBER_TYPE
-#undef DEFINE_SUBSCRIBER_OVERLOAD
-#undef DECLARE_SUBSCRIBER
+    template <typename List>
+    struct handler_count_tuple;
+
+    template <typename... Entries>
+    struct handler_count_tuple<message_list<Entries...>> {
+        using type = std::tuple<handler_count<typename Entries::message>...>;
+    };
+
+    // Shared with the handler wrappers, which may outlive this instance.
+    using handler_counts = typename handler_count_tuple<subscribable_messages>::type;
+    using handler_counts_ptr = std::shared_ptr<handler_counts>;
+    using loader = code (message_subscriber::*)(byte_reader&, uint32_t) const;
+
+    template <typename Message>
+    typename subscriber_type<Message>::ptr find() const {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        shared_lock lock(mutex_);
+        return std::get<typename subscriber_type<Message>::ptr>(subscribers_);
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    // A subscriber, once created, is kept when its handlers are gone.
+    template <typename Message>
+    bool has_handlers() const {
+        return std::get<handler_count<Message>>(*handlers_).value != 0;
+    }
+
+    // Peers may send these as soon as the handshake completes, before the
+    // protocols that handle them have subscribed, so they are not rejected.
+    static constexpr
+    bool handshake_message(domain::message::message_type type) {
+        return type == domain::message::message_type::send_headers
+            || type == domain::message::message_type::fee_filter
+            || type == domain::message::message_type::send_compact;
+    }
+
+    // Returns null if stopped.
+    template <typename Message>
+    typename subscriber_type<Message>::ptr find_or_create() {
+        using subscriber_ptr = typename subscriber_type<Message>::ptr;
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        mutex_.lock_upgrade();
+
+        auto subscriber = std::get<subscriber_ptr>(subscribers_);
+
+        if ( ! subscriber && ! stopped_) {
+            mutex_.unlock_upgrade_and_lock();
+            //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+            subscriber = std::make_shared<subscriber_type<Message>>(pool_, Message::command + "_sub");
+            subscriber->start();
+            std::get<subscriber_ptr>(subscribers_) = subscriber;
+
+            //-----------------------------------------------------------------
+            mutex_.unlock();
+            return subscriber;
+        }
+
+        mutex_.unlock_upgrade();
+        ///////////////////////////////////////////////////////////////////////
+
+        return subscriber;
+    }
+
+    template <typename Entry>
+    code dispatch(byte_reader& reader, uint32_t version) const;
+
+    template <typename... Entries>
+    static constexpr auto make_loaders(message_list<Entries...>);
+
+    threadpool& pool_;
+    unsubscribed_policy const unsubscribed_;
+    dispatch_policy::ptr dispatch_;
+
+    handler_counts_ptr const handlers_;
+
+    // These are protected by mutex.
+    subscribers subscribers_;
+    bool stopped_;
+    mutable upgrade_mutex mutex_;
+};
 
 } // namespace kth::network
 
@@ -5,25 +5,33 @@
 #ifndef KTH_NETWORK_P2P_HPP
 #define KTH_NETWORK_P2P_HPP
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include <kth/domain.hpp>
 
+#include <kth/network/address_blacklist.hpp>
 #include <kth/network/channel.hpp>
+#include <kth/network/channel_index.hpp>
+#include <kth/network/connection_statistics.hpp>
 #include <kth/network/define.hpp>
 #include <kth/network/hosts.hpp>
+#include <kth/network/message_metrics.hpp>
 #include <kth/network/message_subscriber.hpp>
 #include <kth/network/sessions/session_inbound.hpp>
 #include <kth/network/sessions/session_manual.hpp>
 #include <kth/network/sessions/session_outbound.hpp>
 #include <kth/network/sessions/session_seed.hpp>
 #include <kth/network/settings.hpp>
+#include <kth/network/statistics_server.hpp>
 
 namespace kth::network {
 
@@ -45,7 +53,9 @@ public:
     // Templates (send/receive).
     // ------------------------------------------------------------------------
 
-    /// Send message to all connections.
+    /// Send message to all connections. A channel that is congested (see
+    /// proxy::congested) is skipped, with error::peer_throttling, so that a
+    /// slow peer does not buffer every broadcast until its queue limit.
     template <typename Message>
     void broadcast(Message const& message, channel_handler handle_channel, result_handler handle_complete) {
         // Safely copy the channel collection.
@@ -55,9 +65,25 @@ public:
         auto const join_handler = synchronize(handle_complete, channels.size(),
             "p2p_join", synchronizer_terminate::on_count);
 
-        // No pre-serialize, channels may have different protocol versions.
+        // Serialize once per negotiated protocol version, not once per channel.
+        std::vector<proxy::wire_ptr> wires;
+
         for (auto const channel: channels) {
-            channel->send(message, std::bind(&p2p::handle_send, this, std::placeholders::_1, channel, handle_channel, join_handler));
+            if (channel->congested()) {
+                handle_send(error::peer_throttling, channel, handle_channel, join_handler);
+                continue;
+            }
+
+            auto const version = channel->negotiated_version();
+            auto it = std::find_if(wires.begin(), wires.end(), [version](proxy::wire_ptr const& wire) {
+                return wire->version == version;
+            });
+
+            if (it == wires.end()) {
+                it = wires.insert(wires.end(), proxy::serialize(message, version));
+            }
+
+            channel->send(*it, std::bind(&p2p::handle_send, this, std::placeholders::_1, channel, handle_channel, join_handler));
         }
     }
 
@@ -127,6 +153,21 @@ public:
     virtual
     threadpool& thread_pool();
 
+    /// Connection outcomes and handshake latency of sessions of the kind.
+    connection_statistics& connections(session_kind kind);
+
+    /// Statistics in the Prometheus text format, as served on the configured
+    /// statistics_server authority (if its port is nonzero).
+    std::string statistics() const;
+
+    /// Traffic totals by message type of all channels since start, including
+    /// closed channels that had completed the handshake.
+    message_metrics::table metrics() const;
+
+    /// The dispatch modes of received messages, shared by all channels.
+    /// Modes may be changed at any time and apply to all channels.
+    dispatch_policy::ptr message_dispatch_policy() const;
+
     // Subscriptions.
     // ------------------------------------------------------------------------
 
@@ -161,13 +202,13 @@ public:
     virtual
     size_t address_count() const;
 
-    /// Store an address.
+    /// Store an address relayed by source.
     virtual
-    code store(address const& address);
+    code store(address const& address, address const& source);
 
-    /// Store a collection of addresses (asynchronous).
+    /// Store a collection of addresses relayed by source (asynchronous).
     virtual
-    void store(address::list const& addresses, result_handler handler);
+    void store(address::list const& addresses, address const& source, result_handler handler);
 
     /// Get a randomly-selected address.
     virtual
@@ -181,6 +222,26 @@ public:
     virtual
     code remove(address const& address);
 
+    /// Record an outbound connection attempt to an address.
+    virtual
+    code attempt(address const& address);
+
+    /// Record a successful outbound connection to an address.
+    virtual
+    code good(address const& address);
+
+    // Blacklist.
+    // ------------------------------------------------------------------------
+
+    /// Replace the blocked ranges with the blacklist setting and the ranges of
+    /// the blacklist file (if configured), the current ranges kept on error.
+    virtual
+    code load_blacklist();
+
+    /// Determine if the address is within a blocked range.
+    virtual
+    bool blacklisted(infrastructure::config::authority const& authority) const;
+
     // Pending connect collection.
     // ------------------------------------------------------------------------
 
@@ -247,8 +308,13 @@ protected:
     virtual
     session_outbound::ptr attach_outbound_session();
 
+    /// Write a checkpoint of the hosts pool, override to observe checkpoints.
+    virtual
+    code checkpoint_hosts();
+
 private:
-    using pending_channels = kth::pending<channel>;
+    using nonce_channels = channel_index<uint64_t>;
+    using authority_channels = channel_index<infrastructure::config::authority, authority_hash>;
     using pending_connectors = kth::pending<connector>;
 
     void handle_manual_started(code const& ec, result_handler handler);
@@ -260,16 +326,31 @@ private:
     void handle_started(code const& ec, result_handler handler);
     void handle_running(code const& ec, result_handler handler);
 
+    bool stopped(code const& ec) const;
+    void start_checkpoint();
+    void handle_checkpoint(code const& ec);
+
+    void start_statistics();
+
     // These are thread safe.
     settings const& settings_;
     std::atomic<bool> stopped_;
     kth::atomic<infrastructure::config::checkpoint> top_block_;
     kth::atomic<session_manual::ptr> manual_;
+    kth::atomic<statistics_server::ptr> statistics_server_;
+    std::array<connection_statistics, 4> connections_;
     threadpool threadpool_;
     hosts hosts_;
+    address_blacklist blacklist_;
+    deadline::ptr checkpoint_;
+    dispatch_policy::ptr const dispatch_policy_;
+
+    // These are protected by metrics_mutex_.
+    message_metrics::table retired_metrics_;
+    mutable std::mutex metrics_mutex_;
     pending_connectors pending_connect_;
-    pending_channels pending_handshake_;
-    pending_channels pending_close_;
+    nonce_channels pending_handshake_;
+    authority_channels pending_close_;
     stop_subscriber::ptr stop_subscriber_;
     channel_subscriber::ptr channel_subscriber_;
 };
@@ -0,0 +1,99 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_PARSE_BACKLOG_HPP
+#define KTH_NETWORK_PARSE_BACKLOG_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// This class is thread safe.
+/// Payloads read by a pipelined channel and waiting to be parsed. Reading
+/// pauses once more than one payload and more than the maximum bytes are
+/// waiting, and resumes when parsing drains them to the maximum. A single
+/// payload never pauses reading, whatever its size.
+class parse_backlog : noncopyable {
+public:
+    explicit
+    parse_backlog(size_t maximum_bytes)
+        : maximum_bytes_(maximum_bytes)
+        , payloads_(0)
+        , bytes_(0)
+        , paused_(false)
+    {}
+
+    /// Add a payload read, false if reading must pause.
+    bool push(size_t bytes) {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        ++payloads_;
+        bytes_ += bytes;
+        paused_ = paused_ || (payloads_ > 1 && bytes_ > maximum_bytes_);
+        return ! paused_;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    /// Remove a payload parsed, true if paused reading must resume.
+    bool pop(size_t bytes) {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        --payloads_;
+        bytes_ -= bytes;
+
+        if (paused_ && bytes_ <= maximum_bytes_) {
+            paused_ = false;
+            return true;
+        }
+
+        return false;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    /// True if no payload is waiting to be parsed.
+    bool empty() const {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+        return payloads_ == 0;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    bool paused() const {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+        return paused_;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    /// Bytes waiting to be parsed.
+    size_t bytes() const {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+private:
+    size_t const maximum_bytes_;
+
+    // These are protected by mutex_.
+    size_t payloads_;
+    size_t bytes_;
+    bool paused_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace kth::network
+
+#endif
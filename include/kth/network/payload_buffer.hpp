@@ -0,0 +1,57 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_PAYLOAD_BUFFER_HPP
+#define KTH_NETWORK_PAYLOAD_BUFFER_HPP
+
+#include <cstddef>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+#include <kth/network/payload_pool.hpp>
+
+namespace kth::network {
+
+/// This class is not thread safe.
+/// The payload buffer of a channel, borrowed from the pool when the first
+/// payload is read. It starts small and grows geometrically as payloads
+/// require, and returns to the pool after a large payload or after a run of
+/// payloads that fit the minimum capacity, so that an idle channel does not
+/// pin a maximum payload allocation.
+class BCT_API payload_buffer : noncopyable {
+public:
+    /// The capacity of the first buffer (enough for ping, inv, etc).
+    static constexpr size_t minimum_capacity = 4 * 1024;
+
+    /// A buffer grown beyond this capacity is returned once it is parsed.
+    static constexpr size_t maximum_retained_capacity = 256 * 1024;
+
+    /// A grown buffer is returned after this many payloads that fit the
+    /// minimum capacity.
+    static constexpr size_t shrink_count = 128;
+
+    explicit
+    payload_buffer(payload_pool::ptr pool);
+
+    /// Size the buffer to the payload, growing it if required.
+    data_chunk& reserve(size_t size);
+
+    /// The buffer, null before the first payload and once released.
+    payload_pool::buffer_ptr const& get() const;
+
+    /// Give up the buffer, the next payload borrows another.
+    void release();
+
+    /// A payload of the size has been parsed from the buffer, which returns
+    /// to the pool if it is larger than recent payloads require.
+    void parsed(size_t size);
+
+private:
+    payload_pool::ptr const pool_;
+    payload_pool::buffer_ptr buffer_;
+    size_t small_payloads_;
+};
+
+} // namespace kth::network
+
+#endif
@@ -0,0 +1,65 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_PAYLOAD_POOL_HPP
+#define KTH_NETWORK_PAYLOAD_POOL_HPP
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// This class is thread safe.
+/// Size-classed pool of payload buffers shared by all channels.
+/// Buffers are borrowed for the duration of a payload read and return to the
+/// pool when the last reference is released. Each size class retains a
+/// bounded number of free buffers, larger buffers are retained sparingly.
+class BCT_API payload_pool
+  : public std::enable_shared_from_this<payload_pool>, noncopyable
+{
+public:
+    using ptr = std::shared_ptr<payload_pool>;
+    using buffer_ptr = std::shared_ptr<data_chunk>;
+
+    /// The pool shared by all channels of the process.
+    static ptr instance();
+
+    /// Construct an instance, use instance() for the shared pool.
+    payload_pool();
+
+    /// Borrow a buffer resized to the specified size.
+    buffer_ptr acquire(size_t size);
+
+    /// The number of free buffers retained by the pool.
+    size_t retained() const;
+
+private:
+    // Size classes are powers of two from 2^minimum_class_bits.
+    static constexpr size_t minimum_class_bits = 10;
+    static constexpr size_t class_count = 16;
+
+    struct releaser {
+        std::weak_ptr<payload_pool> pool;
+        void operator()(data_chunk* buffer) const;
+    };
+
+    static size_t size_class(size_t size);
+    static size_t class_size(size_t size_class);
+    static size_t class_limit(size_t size_class);
+
+    void release(data_chunk&& buffer);
+
+    // These are protected by mutex.
+    std::array<std::vector<data_chunk>, class_count> free_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace kth::network
+
+#endif
@@ -12,9 +12,17 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 #include <kth/domain.hpp>
+#include <kth/network/block_stream.hpp>
 #include <kth/network/define.hpp>
+#include <kth/network/handler_memory.hpp>
+#include <kth/network/message_metrics.hpp>
 #include <kth/network/message_subscriber.hpp>
+#include <kth/network/parse_backlog.hpp>
+#include <kth/network/payload_buffer.hpp>
+#include <kth/network/payload_pool.hpp>
+#include <kth/network/send_queue.hpp>
 #include <kth/network/settings.hpp>
 
 namespace kth::network {
@@ -28,6 +36,27 @@ public:
     using result_handler = std::function<void(code const&)>;
     using stop_subscriber = subscriber<code>;
 
+    /// A serialized message payload, immutable and shareable by channels.
+    /// The heading is not included, as it depends on the channel magic.
+    struct wire_payload {
+        std::string command;
+        uint32_t version;
+        uint32_t checksum;
+        data_chunk data;
+    };
+
+    using wire_ptr = std::shared_ptr<wire_payload const>;
+
+    /// Serialize a message payload once, for sending to any channel that has
+    /// negotiated the specified protocol version.
+    template <typename Message>
+    static
+    wire_ptr serialize(Message const& message, uint32_t version) {
+        auto data = message.to_data(version);
+        auto const checksum = bitcoin_checksum(data);
+        return std::make_shared<wire_payload const>(wire_payload{ Message::command, version, checksum, std::move(data) });
+    }
+
     /// Construct an instance.
     proxy(threadpool& pool, socket::ptr socket, settings const& settings);
 
@@ -37,15 +66,16 @@ public:
     /// Send a message on the socket.
     template <typename Message>
     void send(Message const& message, result_handler handler) {
-        auto data = domain::message::serialize(version_, message, protocol_magic_);
-        auto const payload = std::make_shared<data_chunk>(std::move(data));
-        auto const command = std::make_shared<std::string>(message.command);
-
-        // Sequential dispatch is required because write may occur in multiple
-        // asynchronous steps invoked on different threads, causing deadlocks.
-        dispatch_.lock(&proxy::do_send, shared_from_this(), command, payload, handler);
+        send(serialize(message, version_), std::move(handler));
     }
 
+    /// Send a serialized message on the socket.
+    void send(wire_ptr wire, result_handler handler);
+
+    /// True once queued sends exceed the high watermark, until they drain
+    /// below the low watermark. Callers should defer optional sends.
+    bool congested() const;
+
     /// Subscribe to messages of the specified type on the socket.
     template <typename Message>
     void subscribe(message_handler<Message>&& handler) {
@@ -68,6 +98,12 @@ public:
     virtual
     void set_negotiated_version(uint32_t value);
 
+    /// Set the dispatch modes of received messages, call before start.
+    void set_dispatch_policy(dispatch_policy::ptr policy);
+
+    /// Traffic counters of this socket by message type.
+    message_metrics const& metrics() const;
+
     /// Read messages from this socket.
     virtual
     void start(result_handler handler);
@@ -89,8 +125,17 @@ protected:
 private:
     using payload_source = byte_source<data_chunk>;
     using payload_stream = boost::iostreams::stream<payload_source>;
-    using command_ptr = std::shared_ptr<std::string>;
-    using payload_ptr = std::shared_ptr<data_chunk>;
+    using heading_ptr = std::shared_ptr<data_chunk>;
+
+    struct queued_send {
+        domain::message::message_type type;
+        heading_ptr heading;
+        wire_ptr wire;
+        result_handler handler;
+    };
+
+    using send_batch = send_queue<queued_send>::batch;
+    using send_batch_ptr = std::shared_ptr<send_batch>;
 
     static infrastructure::config::authority authority_factory(socket::ptr socket);
 
@@ -98,18 +143,35 @@ private:
 
     void read_heading();
     void handle_read_heading(boost_code const& ec, size_t payload_size);
+    bool validate_heading(const domain::message::heading& head);
 
     void read_payload(const domain::message::heading& head);
-    void handle_read_payload(boost_code const& ec, size_t, const domain::message::heading& head);
-
-    void do_send(command_ptr command, payload_ptr payload, result_handler handler);
-    void handle_send(boost_code const& ec, size_t bytes, command_ptr command, payload_ptr payload, result_handler handler);
+    void read_remainder(const domain::message::heading& head, size_t offset);
+    void handle_read_payload(boost_code const& ec, size_t bytes, const domain::message::heading& head, size_t offset);
+    bool handle_payload(const domain::message::heading& head, size_t payload_size);
+    bool parse_payload(const domain::message::heading& head, payload_pool::buffer_ptr const& payload, block_stream::result_ptr const& streamed);
+    bool pipeline_payload(const domain::message::heading& head, payload_pool::buffer_ptr payload, block_stream::result_ptr streamed);
+    void handle_parse(const domain::message::heading& head, payload_pool::buffer_ptr payload, block_stream::result_ptr streamed);
+    void start_stream(const domain::message::heading& head);
+    bool stream_payload(const domain::message::heading& head, size_t size);
+
+    void read_buffered();
+    void handle_read_buffered(boost_code const& ec, size_t bytes);
+    void parse_buffered();
+
+    void do_send();
+    void handle_send(boost_code const& ec, size_t bytes, send_batch_ptr batch);
 
     infrastructure::config::authority const authority_;
 
     // These are protected by read header/payload ordering.
     data_chunk heading_buffer_;
-    data_chunk payload_buffer_;
+    payload_buffer payload_buffer_;
+    block_stream block_stream_;
+    data_chunk read_buffer_;
+    size_t read_begin_;
+    size_t read_end_;
+    handler_memory read_memory_;
     socket::ptr socket_;
 
     // These are thread safe.
@@ -117,11 +179,23 @@ private:
     uint32_t const protocol_magic_;
     size_t const maximum_payload_;
     bool const validate_checksum_;
+    bool const buffered_reads_;
+    bool const pipelined_parse_;
+    bool const streamed_blocks_;
     bool const verbose_;
     std::atomic<uint32_t> version_;
     message_subscriber message_subscriber_;
     stop_subscriber::ptr stop_subscriber_;
-    dispatcher dispatch_;
+    dispatcher parse_dispatch_;
+    message_metrics metrics_;
+
+    send_queue<queued_send> send_queue_;
+
+    // These are protected by send ordering (one write in flight).
+    handler_memory write_memory_;
+    std::vector<::asio::const_buffer> write_buffers_;
+
+    parse_backlog parse_backlog_;
 };
 
 } // namespace kth::network
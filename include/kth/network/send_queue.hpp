@@ -0,0 +1,146 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_SEND_QUEUE_HPP
+#define KTH_NETWORK_SEND_QUEUE_HPP
+
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// This class is thread safe.
+/// Sends waiting behind the single write in flight on a socket. Each write
+/// takes everything queued behind the previous one, so a burst of sends is
+/// written as one batch. Bytes queued and in flight are bounded by a limit,
+/// and the queue is congested from when they exceed the high watermark
+/// until they drain to the low watermark.
+template <typename Item>
+class send_queue : noncopyable {
+public:
+    using batch = std::vector<Item>;
+
+    /// A zero limit is unlimited.
+    send_queue(size_t high_water, size_t low_water, size_t limit)
+        : high_water_(high_water)
+        , low_water_(low_water)
+        , limit_(limit)
+        , waiting_bytes_(0)
+        , writing_bytes_(0)
+        , sending_(false)
+        , congested_(false)
+    {}
+
+    /// Queue an item of the specified size, false (not queued) if it would
+    /// exceed the limit. Sets start if the caller must start a write (take).
+    bool push(Item item, size_t bytes, bool& start) {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (limit_ != 0 && waiting_bytes_ + writing_bytes_ + bytes > limit_) {
+            start = false;
+            return false;
+        }
+
+        waiting_.push_back(std::move(item));
+        waiting_bytes_ += bytes;
+        congested_ = congested_ || waiting_bytes_ + writing_bytes_ > high_water_;
+
+        // Only one write may be in flight, its completion starts the next.
+        start = ! sending_;
+        sending_ = true;
+        return true;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    /// Take the queued items, in order, as the write in flight.
+    batch take() {
+        batch out;
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        out.reserve(waiting_.size());
+        std::move(waiting_.begin(), waiting_.end(), std::back_inserter(out));
+        waiting_.clear();
+        writing_bytes_ += waiting_bytes_;
+        waiting_bytes_ = 0;
+        return out;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    /// Complete the write in flight, true if the caller must start the next.
+    bool complete() {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        writing_bytes_ = 0;
+        congested_ = congested_ && waiting_bytes_ > low_water_;
+        sending_ = ! waiting_.empty();
+        return sending_;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    /// Remove the queued items, not including the write in flight.
+    batch clear() {
+        batch out;
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        out.reserve(waiting_.size());
+        std::move(waiting_.begin(), waiting_.end(), std::back_inserter(out));
+        waiting_.clear();
+        waiting_bytes_ = 0;
+        congested_ = congested_ && writing_bytes_ > low_water_;
+        return out;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    /// True once bytes exceed the high watermark, until they drain to the
+    /// low watermark. Callers should defer optional sends.
+    bool congested() const {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+        return congested_;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    /// Bytes queued and in flight.
+    size_t bytes() const {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+        return waiting_bytes_ + writing_bytes_;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+private:
+    size_t const high_water_;
+    size_t const low_water_;
+    size_t const limit_;
+
+    // These are protected by mutex_.
+    std::deque<Item> waiting_;
+    size_t waiting_bytes_;
+    size_t writing_bytes_;
+    bool sending_;
+    bool congested_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace kth::network
+
+#endif
@@ -6,6 +6,7 @@
 #define KTH_NETWORK_SESSION_HPP
 
 #include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <functional>
 #include <memory>
@@ -13,6 +14,7 @@
 #include <kth/domain.hpp>
 #include <kth/network/acceptor.hpp>
 #include <kth/network/channel.hpp>
+#include <kth/network/connection_statistics.hpp>
 #include <kth/network/connector.hpp>
 #include <kth/network/define.hpp>
 #include <kth/network/proxy.hpp>
@@ -57,7 +59,7 @@ public:
 protected:
 
     /// Construct an instance.
-    session(p2p& network, bool notify_on_connect);
+    session(p2p& network, bool notify_on_connect, session_kind kind);
 
     /// Validate session stopped.
     ~session();
@@ -105,10 +107,15 @@ protected:
     virtual size_t address_count() const;
     virtual size_t connection_count() const;
     virtual code fetch_address(address& out_address) const;
+    virtual code attempt(address const& host);
+    virtual code good(address const& host);
     virtual bool blacklisted(authority const& authority) const;
     virtual bool stopped() const;
     virtual bool stopped(code const& ec) const;
 
+    /// Count a failed connection attempt in the statistics of this session.
+    void connect_failed();
+
     /// Socket creators.
     // ------------------------------------------------------------------------
 
@@ -159,14 +166,17 @@ private:
     using connectors = kth::pending<connector>;
 
     void handle_stop(code const& ec);
-    void handle_starting(code const& ec, channel::ptr channel, result_handler handle_started);
-    void handle_handshake(code const& ec, channel::ptr channel, result_handler handle_started);
+    using clock = std::chrono::steady_clock;
+
+    void handle_starting(code const& ec, channel::ptr channel, clock::time_point started, result_handler handle_started);
+    void handle_handshake(code const& ec, channel::ptr channel, clock::time_point started, result_handler handle_started);
     void handle_start(code const& ec, channel::ptr channel, result_handler handle_started, result_handler handle_stopped);
     void handle_remove(code const& ec, channel::ptr channel, result_handler handle_stopped);
 
     // These are thread safe.
     std::atomic<bool> stopped_;
     bool const notify_on_connect_;
+    session_kind const kind_;
     p2p& network_;
     mutable dispatcher dispatch_;
 };
@@ -20,7 +20,7 @@ class p2p;
 class BCT_API session_batch : public session {
 protected:
     /// Construct an instance.
-    session_batch(p2p& network, bool notify_on_connect);
+    session_batch(p2p& network, bool notify_on_connect, session_kind kind);
 
     /// Create a channel from the configured number of concurrent attempts.
     virtual void connect(channel_handler handler);
@@ -28,7 +28,7 @@ protected:
 private:
     // Connect sequence
     void new_connect(channel_handler handler);
-    void start_connect(code const& ec, authority const& host, channel_handler handler);
+    void start_connect(code const& ec, address const& host, channel_handler handler);
     void handle_connect(code const& ec, channel::ptr channel, connector::ptr connector, channel_handler handler);
 
     size_t const batch_size_;
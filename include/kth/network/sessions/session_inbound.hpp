@@ -11,7 +11,9 @@
 #include <kth/domain.hpp>
 #include <kth/network/acceptor.hpp>
 #include <kth/network/channel.hpp>
+#include <kth/network/connection_slots.hpp>
 #include <kth/network/define.hpp>
+#include <kth/network/inbound_admission.hpp>
 #include <kth/network/sessions/session.hpp>
 #include <kth/network/settings.hpp>
 
@@ -42,14 +44,16 @@ private:
 
     void handle_stop(code const& ec);
     void handle_started(code const& ec, result_handler handler);
+    code admit(authority const& authority);
     void handle_accept(code const& ec, channel::ptr channel);
 
     void handle_channel_start(code const& ec, channel::ptr channel);
-    void handle_channel_stop(code const& ec);
+    void handle_channel_stop(code const& ec, connection_slots::ip_address const& ip);
 
     // These are thread safe.
     acceptor::ptr acceptor_;
     size_t const connection_limit_;
+    inbound_admission admission_;
 };
 
 } // namespace kth::network
@@ -15,6 +15,19 @@
 
 namespace kth::network {
 
+/// Treatment of a received message of a type with no subscriber.
+enum class unsubscribed_policy {
+    /// Parse and discard, a malformed message stops the channel (default).
+    parse,
+
+    /// Discard without parsing.
+    skip,
+
+    /// Stop the channel, except for sendheaders, feefilter and sendcmpct,
+    /// which peers send before the protocols that handle them subscribe.
+    reject
+};
+
 /// Common database configuration settings, properties not thread safe.
 class BCT_API settings {
 public:
@@ -29,9 +42,18 @@ public:
     uint64_t invalid_services;
     bool relay_transactions;
     bool validate_checksum;
+    bool buffered_reads;
+    bool pipelined_parse;
+    bool streamed_blocks;
+    unsubscribed_policy unsubscribed_messages;
     uint32_t identifier;
     uint16_t inbound_port;
     uint32_t inbound_connections;
+    uint32_t inbound_connections_per_ip;
+    uint32_t inbound_connections_per_group;
+    uint32_t inbound_accepts_per_second;
+    uint32_t inbound_accept_burst;
+    uint32_t inbound_handshakes;
     uint32_t outbound_connections;
     uint32_t manual_attempt_limit;
     uint32_t connect_batch_size;
@@ -42,7 +64,12 @@ public:
     uint32_t channel_expiration_minutes;
     uint32_t channel_germination_seconds;
     uint32_t host_pool_capacity;
+    uint32_t host_pool_checkpoint_minutes;
+    uint32_t send_high_water_kilobytes;
+    uint32_t send_low_water_kilobytes;
+    uint32_t send_queue_limit_kilobytes;
     kth::path hosts_file;
+    kth::path blacklist_file;
     infrastructure::config::authority self;
     infrastructure::config::authority::list blacklist;
     infrastructure::config::endpoint::list peers;
@@ -74,6 +101,7 @@ public:
     asio::duration channel_inactivity() const;
     asio::duration channel_expiration() const;
     asio::duration channel_germination() const;
+    asio::duration host_pool_checkpoint() const;
 };
 
 } // namespace kth::network
@@ -0,0 +1,74 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_STATISTICS_SERVER_HPP
+#define KTH_NETWORK_STATISTICS_SERVER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// This class is thread safe.
+/// Minimal HTTP endpoint that serves "GET /metrics" with the text rendered by
+/// the handler (Prometheus exposition format). Each request is answered and
+/// the connection closed. A connection is closed if it is not answered by
+/// the timeout, and connections beyond the limit are closed unanswered.
+class BCT_API statistics_server
+  : public enable_shared_from_base<statistics_server>, noncopyable
+{
+public:
+    using ptr = std::shared_ptr<statistics_server>;
+    using render_handler = std::function<std::string()>;
+
+    /// Construct an instance.
+    statistics_server(threadpool& pool, render_handler render,
+        asio::duration timeout = asio::seconds(10), size_t connection_limit = 8);
+
+    /// Listen on the authority and start accepting, port zero binds any port.
+    code start(infrastructure::config::authority const& authority);
+
+    /// The bound port, zero if not started.
+    uint16_t port() const;
+
+    /// Stop accepting requests.
+    void stop();
+
+private:
+    using request_ptr = std::shared_ptr<std::string>;
+    using response_ptr = std::shared_ptr<std::string>;
+
+    bool stopped() const;
+    void accept();
+    void handle_accept(boost_code const& ec, socket::ptr socket);
+    void handle_timeout(code const& ec, socket::ptr socket);
+    void handle_read(boost_code const& ec, size_t bytes, socket::ptr socket, deadline::ptr timer, request_ptr request);
+    void handle_write(boost_code const& ec, size_t bytes, socket::ptr socket, deadline::ptr timer, response_ptr response);
+    void finish(socket::ptr socket, deadline::ptr timer);
+
+    response_ptr respond(std::string const& request) const;
+
+    // These are thread safe.
+    threadpool& pool_;
+    render_handler const render_;
+    asio::duration const timeout_;
+    size_t const connection_limit_;
+    std::atomic<size_t> connections_;
+    std::atomic<bool> stopped_;
+    std::atomic<uint16_t> port_;
+
+    // These are protected by mutex.
+    asio::acceptor acceptor_;
+    mutable upgrade_mutex mutex_;
+};
+
+} // namespace kth::network
+
+#endif
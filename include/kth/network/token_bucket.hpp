@@ -0,0 +1,42 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_TOKEN_BUCKET_HPP
+#define KTH_NETWORK_TOKEN_BUCKET_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <kth/domain.hpp>
+#include <kth/network/define.hpp>
+
+namespace kth::network {
+
+/// This class is thread safe.
+/// Tokens refill at a fixed rate up to the burst size, which allows bursts
+/// while bounding the sustained rate. The bucket starts full.
+class BCT_API token_bucket : noncopyable {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /// Construct with tokens per second and burst size, zero rate is unlimited.
+    token_bucket(size_t rate, size_t burst);
+
+    /// Take a token, false if none is available.
+    bool consume();
+    bool consume(clock::time_point now);
+
+private:
+    double const rate_;
+    double const burst_;
+
+    // These are protected by mutex.
+    double tokens_;
+    clock::time_point updated_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace kth::network
+
+#endif
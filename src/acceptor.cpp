@@ -100,6 +100,10 @@ code acceptor::listen(uint16_t port) {
 }
 
 void acceptor::accept(accept_handler handler) {
+    accept(nullptr, handler);
+}
+
+void acceptor::accept(admission_handler admit, accept_handler handler) {
     // Critical Section
     ///////////////////////////////////////////////////////////////////////////
     mutex_.lock_upgrade();
@@ -121,19 +125,25 @@ void acceptor::accept(accept_handler handler) {
     // TODO: if the accept is invoked on a thread of the acceptor, as opposed
     // to the thread of the socket, then this is unnecessary.
     acceptor_.async_accept(socket->get(),
-        std::bind(&acceptor::handle_accept, shared_from_this(), _1, socket, handler));
+        std::bind(&acceptor::handle_accept, shared_from_this(), _1, socket, admit, handler));
 
     mutex_.unlock();
     ///////////////////////////////////////////////////////////////////////////
 }
 
 // private:
-void acceptor::handle_accept(boost_code const& ec, socket::ptr socket, accept_handler handler) {
+void acceptor::handle_accept(boost_code const& ec, socket::ptr socket, admission_handler admit, accept_handler handler) {
     if (ec) {
         handler(error::boost_to_error_code(ec), nullptr);
         return;
     }
 
+    // A rejected socket costs only its close, as it goes out of scope here.
+    if (admit && admit(socket->authority())) {
+        accept(admit, handler);
+        return;
+    }
+
     // Ensure that channel is not passed as an r-value.
     auto const created = std::make_shared<channel>(pool_, socket, settings_);
     handler(error::success, created);
@@ -0,0 +1,157 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/address_blacklist.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <kth/domain.hpp>
+
+namespace kth::network {
+
+// Bits of the IPv4-mapped prefix (::ffff:0:0/96).
+static size_t const mapped_prefix_bits = 96;
+
+static size_t const address_bits = 128;
+
+static
+std::string trim(std::string const& text) {
+    auto const first = text.find_first_not_of(" \t\r");
+
+    if (first == std::string::npos) {
+        return {};
+    }
+
+    auto const last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+bool address_blacklist::parse(std::string const& text, range& out) {
+    auto const slash = text.find('/');
+    auto const host = text.substr(0, slash);
+
+    boost_code ec;
+    auto const address = ::asio::ip::make_address(host, ec);
+
+    if (ec) {
+        return false;
+    }
+
+    auto const ipv4 = address.is_v4();
+    auto const maximum = ipv4 ? address_bits - mapped_prefix_bits : address_bits;
+    auto prefix = maximum;
+
+    if (slash != std::string::npos) {
+        auto const digits = text.substr(slash + 1);
+
+        if (digits.empty() || digits.size() > 3 ||
+            ! std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            return false;
+        }
+
+        prefix = std::stoul(digits);
+
+        if (prefix > maximum) {
+            return false;
+        }
+    }
+
+    auto const mapped = ipv4 ?
+        ::asio::ip::make_address_v6(::asio::ip::v4_mapped, address.to_v4()) :
+        address.to_v6();
+
+    auto const bytes = mapped.to_bytes();
+    auto const bits = ipv4 ? prefix + mapped_prefix_bits : prefix;
+
+    // Clear (first) or set (last) the bits beyond the prefix.
+    for (size_t byte = 0; byte < out.first.size(); ++byte) {
+        auto const kept = std::min(size_t(8), bits > byte * 8 ? bits - byte * 8 : size_t(0));
+        auto const mask = static_cast<uint8_t>(kept == 0 ? 0 : 0xff << (8 - kept));
+        out.first[byte] = bytes[byte] & mask;
+        out.last[byte] = bytes[byte] | static_cast<uint8_t>(~mask);
+    }
+
+    return true;
+}
+
+address_blacklist::range address_blacklist::single(ip_address const& ip) {
+    return { ip, ip };
+}
+
+address_blacklist::address_blacklist()
+    : table_(std::make_shared<ranges const>())
+{}
+
+// Sort by first address and merge overlapping ranges.
+void address_blacklist::assign(ranges values) {
+    std::sort(values.begin(), values.end(), [](range const& left, range const& right) {
+        return left.first < right.first;
+    });
+
+    ranges merged;
+    merged.reserve(values.size());
+
+    for (auto const& value: values) {
+        if ( ! merged.empty() && value.first <= merged.back().last) {
+            merged.back().last = std::max(merged.back().last, value.last);
+        } else {
+            merged.push_back(value);
+        }
+    }
+
+    merged.shrink_to_fit();
+    table_.store(std::make_shared<ranges const>(std::move(merged)));
+}
+
+code address_blacklist::read(kth::path const& file, ranges& values) {
+    std::ifstream stream(file.string());
+
+    if ( ! stream) {
+        return error::file_system;
+    }
+
+    std::string line;
+
+    while (std::getline(stream, line)) {
+        auto const text = trim(line.substr(0, line.find('#')));
+
+        if (text.empty()) {
+            continue;
+        }
+
+        range value;
+
+        if ( ! parse(text, value)) {
+            return error::bad_stream;
+        }
+
+        values.push_back(value);
+    }
+
+    return stream.bad() ? error::file_system : error::success;
+}
+
+// The last range starting at or before the address is the only candidate.
+bool address_blacklist::blocked(ip_address const& ip) const {
+    auto const values = table_.load();
+    auto const it = std::upper_bound(values->begin(), values->end(), ip,
+        [](ip_address const& left, range const& right) {
+            return left < right.first;
+        });
+
+    return it != values->begin() && ip <= std::prev(it)->last;
+}
+
+size_t address_blacklist::size() const {
+    return table_.load()->size();
+}
+
+} // namespace kth::network
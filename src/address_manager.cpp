@@ -0,0 +1,389 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/address_manager.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <boost/container_hash/hash.hpp>
+#include <kth/domain.hpp>
+
+namespace kth::network {
+
+using namespace kd::message;
+
+// Upper bound on addresses in a single bucket.
+static size_t const maximum_bucket_size = 16;
+
+// A single source netgroup may only populate this many new buckets.
+static size_t const source_group_buckets = 8;
+
+// A single netgroup may only populate this many tried buckets.
+static size_t const group_tried_buckets = 4;
+
+// One quarter of the capacity is reserved for addresses that have connected.
+static size_t const tried_ratio = 4;
+
+// Number of random draws before settling on the last candidate.
+static size_t const select_attempts = 32;
+
+// Fixed point scale of the selection chance.
+static uint32_t const chance_scale = 1u << 16;
+
+// Failures beyond this no longer reduce the selection chance.
+static uint32_t const maximum_penalized_failures = 8;
+
+// Addresses attempted within this many seconds are rarely selected again.
+static uint32_t const recent_attempt_seconds = 10 * 60;
+
+static
+size_t bucket_size(size_t capacity) {
+    return std::max(std::min(maximum_bucket_size, capacity), size_t(1));
+}
+
+static
+size_t tried_capacity(size_t capacity) {
+    return capacity / tried_ratio;
+}
+
+static
+size_t new_capacity(size_t capacity) {
+    return capacity - tried_capacity(capacity);
+}
+
+address_manager::address_manager(size_t capacity)
+    : bucket_size_(bucket_size(new_capacity(capacity)))
+    , new_buckets_(std::max(new_capacity(capacity) / bucket_size_, size_t(1)))
+    , tried_buckets_(tried_capacity(capacity) / bucket_size_)
+    , key_(static_cast<size_t>(pseudo_random_broken_do_not_use::next()))
+    , new_slots_(new_buckets_)
+    , tried_slots_(tried_buckets_)
+{}
+
+// Hashing.
+// ----------------------------------------------------------------------------
+
+size_t address_manager::address_hash::operator()(address const& host) const {
+    auto const& ip = host.ip();
+    auto seed = boost::hash_range(ip.begin(), ip.end());
+    boost::hash_combine(seed, host.port());
+    return seed;
+}
+
+bool address_manager::address_equal::operator()(address const& left, address const& right) const {
+    return left.port() == right.port() && left.ip() == right.ip();
+}
+
+// IPv4 addresses are carried as IPv4-mapped IPv6 (::ffff:a.b.c.d).
+uint64_t address_manager::netgroup(ip_address const& ip) {
+    static uint8_t const mapped_prefix[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+    auto const ipv4 = std::equal(std::begin(mapped_prefix), std::end(mapped_prefix), ip.begin());
+
+    if (ipv4) {
+        return (uint64_t(4) << 32) | (uint64_t(ip[12]) << 8) | ip[13];
+    }
+
+    return (uint64_t(6) << 32) | (uint64_t(ip[0]) << 24) | (uint64_t(ip[1]) << 16) |
+        (uint64_t(ip[2]) << 8) | ip[3];
+}
+
+// private
+size_t address_manager::new_bucket(address const& host, uint64_t source_group) const {
+    auto spread = key_;
+    boost::hash_combine(spread, netgroup(host.ip()));
+    boost::hash_combine(spread, source_group);
+
+    auto seed = key_;
+    boost::hash_combine(seed, source_group);
+    boost::hash_combine(seed, spread % source_group_buckets);
+    return seed % new_buckets_;
+}
+
+// private
+size_t address_manager::tried_bucket(address const& host) const {
+    auto spread = key_;
+    boost::hash_combine(spread, address_hash{}(host));
+
+    auto seed = key_;
+    boost::hash_combine(seed, netgroup(host.ip()));
+    boost::hash_combine(seed, spread % group_tried_buckets);
+    return seed % tried_buckets_;
+}
+
+// Properties.
+// ----------------------------------------------------------------------------
+
+size_t address_manager::size() const {
+    return records_.size();
+}
+
+size_t address_manager::tried_size() const {
+    return tried_.size();
+}
+
+bool address_manager::empty() const {
+    return records_.empty();
+}
+
+bool address_manager::exists(address const& host) const {
+    return records_.find(host) != records_.end();
+}
+
+// Mutation.
+// ----------------------------------------------------------------------------
+
+bool address_manager::add(address const& host, address const& source) {
+    auto const it = records_.find(host);
+
+    if (it != records_.end()) {
+        // Refresh what we know of the address without changing its placement.
+        auto& stored = it->second.value.host;
+        auto const timestamp = std::max(stored.timestamp(), host.timestamp());
+        stored.set_services(stored.services() | host.services());
+        stored.set_timestamp(timestamp);
+        return false;
+    }
+
+    insert({ host, netgroup(source.ip()), 0, 0, 0, false });
+    return true;
+}
+
+bool address_manager::restore(entry const& value) {
+    if (exists(value.host)) {
+        return false;
+    }
+
+    insert(value);
+    return true;
+}
+
+bool address_manager::remove(address const& host) {
+    auto const it = records_.find(host);
+
+    if (it == records_.end()) {
+        return false;
+    }
+
+    erase(it);
+    return true;
+}
+
+void address_manager::attempt(address const& host, uint32_t now) {
+    auto const it = records_.find(host);
+
+    if (it == records_.end()) {
+        return;
+    }
+
+    auto& value = it->second.value;
+    value.last_attempt = now;
+    value.failures = ceiling_add(value.failures, uint32_t(1));
+}
+
+void address_manager::good(address const& host, uint32_t now) {
+    auto const it = records_.find(host);
+
+    if (it == records_.end()) {
+        return;
+    }
+
+    auto value = it->second.value;
+    value.last_success = now;
+    value.last_attempt = now;
+    value.failures = 0;
+
+    if (value.tried || tried_buckets_ == 0) {
+        it->second.value = value;
+        return;
+    }
+
+    erase(it);
+    value.tried = true;
+    insert(value);
+}
+
+void address_manager::clear() {
+    records_.clear();
+    new_.clear();
+    tried_.clear();
+
+    for (auto& bucket: new_slots_) {
+        bucket.clear();
+    }
+
+    for (auto& bucket: tried_slots_) {
+        bucket.clear();
+    }
+}
+
+// private
+// A full bucket evicts (new) or demotes to new (tried) its worst entry.
+void address_manager::insert(entry const& value) {
+    auto const tried = value.tried && tried_buckets_ != 0;
+    auto const bucket = tried ? tried_bucket(value.host) :
+        new_bucket(value.host, value.source_group);
+
+    auto& slot = slots(tried)[bucket];
+
+    if (slot.size() >= bucket_size_) {
+        auto const evicted = *victim(slot);
+
+        if (tried) {
+            demote(evicted);
+        } else {
+            erase(records_.find(evicted));
+        }
+    }
+
+    auto& members = list(tried);
+    record stored{ value, bucket, members.size() };
+    stored.value.tried = tried;
+
+    slots(tried)[bucket].push_back(value.host);
+    members.push_back(value.host);
+    records_.emplace(value.host, stored);
+}
+
+// private
+void address_manager::erase(records::iterator it) {
+    auto const& stored = it->second;
+    auto const tried = stored.value.tried;
+
+    auto& slot = slots(tried)[stored.bucket];
+    auto const found = std::find_if(slot.begin(), slot.end(),
+        [&](address const& host) { return address_equal{}(host, stored.value.host); });
+
+    if (found != slot.end()) {
+        slot.erase(found);
+    }
+
+    // Swap with the last member so that removal is constant time.
+    auto& members = list(tried);
+    auto const position = stored.position;
+
+    if (position + 1 != members.size()) {
+        members[position] = members.back();
+        records_.find(members[position])->second.position = position;
+    }
+
+    members.pop_back();
+    records_.erase(it);
+}
+
+// private
+void address_manager::demote(address const& host) {
+    auto const it = records_.find(host);
+    auto value = it->second.value;
+    erase(it);
+    value.tried = false;
+    insert(value);
+}
+
+// private
+// Prefer evicting the most failed entry, and the oldest among equals.
+address_manager::table::const_iterator address_manager::victim(table const& bucket) const {
+    auto const failures = [this](address const& host) {
+        return records_.find(host)->second.value.failures;
+    };
+
+    auto const worse = [&](address const& left, address const& right) {
+        return failures(left) < failures(right);
+    };
+
+    // max_element returns the first of equally bad entries.
+    return std::max_element(bucket.begin(), bucket.end(), worse);
+}
+
+// private
+address_manager::table& address_manager::list(bool tried) {
+    return tried ? tried_ : new_;
+}
+
+// private
+address_manager::buckets& address_manager::slots(bool tried) {
+    return tried ? tried_slots_ : new_slots_;
+}
+
+// Selection.
+// ----------------------------------------------------------------------------
+
+// private
+// Each unresolved failure reduces the chance by a third (up to a limit).
+uint32_t address_manager::chance(entry const& value, uint32_t now) {
+    uint64_t result = chance_scale;
+    auto const failures = std::min(value.failures, maximum_penalized_failures);
+
+    for (uint32_t failure = 0; failure < failures; ++failure) {
+        result = result * 2 / 3;
+    }
+
+    if (value.last_attempt != 0 && now >= value.last_attempt &&
+        now - value.last_attempt < recent_attempt_seconds) {
+        result /= 100;
+    }
+
+    return static_cast<uint32_t>(std::max(result, uint64_t(1)));
+}
+
+bool address_manager::select(address& out, uint32_t now) const {
+    if (records_.empty()) {
+        return false;
+    }
+
+    // Draw from tried and new evenly when both are populated.
+    auto const use_tried = new_.empty() || ( ! tried_.empty() &&
+        pseudo_random_broken_do_not_use::next(0, 1) == 0);
+
+    auto const& members = use_tried ? tried_ : new_;
+
+    for (size_t draw = 0; draw < select_attempts; ++draw) {
+        auto const index = static_cast<size_t>(pseudo_random_broken_do_not_use::next(0, members.size() - 1));
+        auto const& value = records_.find(members[index])->second.value;
+        out = value.host;
+
+        if (pseudo_random_broken_do_not_use::next(0, chance_scale - 1) < chance(value, now)) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+void address_manager::copy(address::list& out, size_t count) const {
+    out.reserve(out.size() + std::min(count, records_.size()));
+
+    for (auto const& host: tried_) {
+        if (count-- == 0) {
+            return;
+        }
+
+        out.push_back(records_.find(host)->second.value.host);
+    }
+
+    for (auto const& host: new_) {
+        if (count-- == 0) {
+            return;
+        }
+
+        out.push_back(records_.find(host)->second.value.host);
+    }
+}
+
+address_manager::entries address_manager::snapshot() const {
+    entries out;
+    out.reserve(records_.size());
+
+    for (auto const& host: tried_) {
+        out.push_back(records_.find(host)->second.value);
+    }
+
+    for (auto const& host: new_) {
+        out.push_back(records_.find(host)->second.value);
+    }
+
+    return out;
+}
+
+} // namespace kth::network
@@ -0,0 +1,277 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/block_stream.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <kth/domain.hpp>
+
+namespace kth::network {
+
+using namespace kd::chain;
+
+// The serialized size of a block header.
+static size_t const header_size = 80;
+
+// The smallest possible serialized transaction (no inputs or outputs).
+static size_t const minimum_transaction_size = 10;
+
+// The smallest possible serialized input and output (empty scripts).
+static size_t const minimum_input_size = 36 + 1 + 4;
+static size_t const minimum_output_size = 8 + 1;
+
+// Reads a variable length integer, false if it has not fully arrived.
+static
+bool read_variable(uint8_t const*& it, uint8_t const* end, uint64_t& out) {
+    if (it == end) {
+        return false;
+    }
+
+    auto const prefix = *it;
+    size_t const width = prefix == 0xff ? 8 : prefix == 0xfe ? 4 : prefix == 0xfd ? 2 : 0;
+
+    if (size_t(end - it) < 1 + width) {
+        return false;
+    }
+
+    ++it;
+
+    if (width == 0) {
+        out = prefix;
+        return true;
+    }
+
+    out = 0;
+    for (size_t byte = 0; byte < width; ++byte) {
+        out |= uint64_t(*it++) << (8 * byte);
+    }
+
+    return true;
+}
+
+block_stream::block_stream()
+    : active_(false)
+    , payload_size_(0)
+    , position_(0)
+    , scan_{}
+    , parse_time_(0)
+{}
+
+bool block_stream::active() const {
+    return active_;
+}
+
+void block_stream::start(size_t payload_size) {
+    reset();
+    active_ = true;
+    payload_size_ = payload_size;
+}
+
+void block_stream::reset() {
+    active_ = false;
+    payload_size_ = 0;
+    position_ = 0;
+    header_.reset();
+    count_.reset();
+    transactions_.clear();
+    scan_ = {};
+    parse_time_ = std::chrono::nanoseconds(0);
+}
+
+bool block_stream::update(data_chunk const& payload, size_t size) {
+    auto const start = std::chrono::steady_clock::now();
+    auto const end = payload.data() + std::min(size, payload.size());
+    auto valid = true;
+
+    if ( ! header_ && size_t(end - payload.data()) >= header_size) {
+        byte_reader reader(byte_span{ payload.data(), header_size });
+        auto header = header::from_data(reader);
+        valid = bool(header);
+
+        if (valid) {
+            header_ = std::move(*header);
+            position_ = header_size;
+        }
+    }
+
+    if (valid && header_ && ! count_) {
+        auto it = payload.data() + position_;
+        uint64_t count;
+
+        if (read_variable(it, end, count)) {
+            // Bound the reservation by what the payload could possibly hold.
+            valid = count <= (payload_size_ - header_size) / minimum_transaction_size;
+
+            if (valid) {
+                // Transactions not yet received are not reserved, as the
+                // declared payload size may not be honored.
+                count_ = count;
+                transactions_.reserve(size_t(std::min<uint64_t>(count, uint64_t(end - it) / minimum_transaction_size)));
+                position_ = size_t(it - payload.data());
+            }
+        }
+    }
+
+    while (valid && count_ && transactions_.size() < *count_) {
+        auto const begin = payload.data() + position_;
+        auto const scanned = scan(scan_, begin, end, payload_size_ - position_);
+
+        if (scanned == scan_result::incomplete) {
+            break;
+        }
+
+        valid = scanned == scan_result::complete;
+
+        if ( ! valid) {
+            break;
+        }
+
+        byte_reader reader(byte_span{ begin, scan_.size });
+        auto tx = transaction::from_data(reader, true);
+        valid = tx && reader.is_exhausted();
+
+        if (valid) {
+            transactions_.push_back(std::move(*tx));
+            position_ += scan_.size;
+            scan_ = {};
+        }
+    }
+
+    parse_time_ += std::chrono::steady_clock::now() - start;
+    return valid;
+}
+
+// private
+// Advances the scan of the transaction at begin over the fields that have
+// fully arrived (before end). Scripts are skipped, not parsed. A field that
+// claims more than the limit bytes of the payload makes it invalid.
+block_stream::scan_result block_stream::scan(scan_state& state, uint8_t const* begin, uint8_t const* end, size_t limit) {
+    auto it = begin + state.size;
+
+    auto const skip = [&](uint64_t bytes) {
+        if (uint64_t(end - it) < bytes) {
+            return false;
+        }
+
+        it += bytes;
+        return true;
+    };
+
+    auto const payload_left = [&]() {
+        return uint64_t(limit - size_t(it - begin));
+    };
+
+    while (state.next != field::complete) {
+        auto const next = state.next;
+
+        switch (next) {
+            case field::version:
+                if (skip(4)) {
+                    state.next = field::input_count;
+                }
+                break;
+            case field::input_count:
+                if (read_variable(it, end, state.remaining)) {
+                    if (state.remaining > payload_left() / minimum_input_size) {
+                        return scan_result::invalid;
+                    }
+
+                    state.next = state.remaining == 0 ? field::output_count : field::previous_output;
+                }
+                break;
+            case field::previous_output:
+                if (skip(36)) {
+                    state.next = field::input_script_size;
+                }
+                break;
+            case field::input_script_size:
+                if (read_variable(it, end, state.script)) {
+                    if (state.script > payload_left()) {
+                        return scan_result::invalid;
+                    }
+
+                    state.next = field::input_script;
+                }
+                break;
+            case field::input_script:
+                if (skip(state.script)) {
+                    state.next = field::sequence;
+                }
+                break;
+            case field::sequence:
+                if (skip(4)) {
+                    state.next = --state.remaining == 0 ? field::output_count : field::previous_output;
+                }
+                break;
+            case field::output_count:
+                if (read_variable(it, end, state.remaining)) {
+                    if (state.remaining > payload_left() / minimum_output_size) {
+                        return scan_result::invalid;
+                    }
+
+                    state.next = state.remaining == 0 ? field::locktime : field::value;
+                }
+                break;
+            case field::value:
+                if (skip(8)) {
+                    state.next = field::output_script_size;
+                }
+                break;
+            case field::output_script_size:
+                if (read_variable(it, end, state.script)) {
+                    if (state.script > payload_left()) {
+                        return scan_result::invalid;
+                    }
+
+                    state.next = field::output_script;
+                }
+                break;
+            case field::output_script:
+                if (skip(state.script)) {
+                    state.next = --state.remaining == 0 ? field::locktime : field::value;
+                }
+                break;
+            case field::locktime:
+                if (skip(4)) {
+                    state.next = field::complete;
+                }
+                break;
+            case field::complete:
+                break;
+        }
+
+        // The field has not fully arrived.
+        if (state.next == next) {
+            state.size = size_t(it - begin);
+            return scan_result::incomplete;
+        }
+    }
+
+    state.size = size_t(it - begin);
+    return scan_result::complete;
+}
+
+block_stream::result_ptr block_stream::finish() {
+    auto const complete = header_ && count_ && transactions_.size() == *count_ &&
+        position_ == payload_size_;
+
+    if ( ! complete) {
+        reset();
+        return nullptr;
+    }
+
+    auto out = std::make_shared<result>(result{
+        domain::message::block(std::move(*header_), std::move(transactions_)),
+        parse_time_ });
+
+    reset();
+    return out;
+}
+
+} // namespace kth::network
@@ -0,0 +1,20 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/channel_index.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <boost/container_hash/hash.hpp>
+#include <kth/domain.hpp>
+
+namespace kth::network {
+
+size_t authority_hash::operator()(infrastructure::config::authority const& authority) const {
+    auto seed = std::hash<::asio::ip::address>{}(authority.asio_ip());
+    boost::hash_combine(seed, authority.port());
+    return seed;
+}
+
+} // namespace kth::network
@@ -0,0 +1,77 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/connection_slots.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <boost/container_hash/hash.hpp>
+#include <kth/domain.hpp>
+#include <kth/network/address_manager.hpp>
+
+namespace kth::network {
+
+connection_slots::connection_slots(size_t ip_limit, size_t group_limit)
+    : ip_limit_(ip_limit)
+    , group_limit_(group_limit)
+{}
+
+size_t connection_slots::ip_hash::operator()(ip_address const& ip) const {
+    return boost::hash_range(ip.begin(), ip.end());
+}
+
+bool connection_slots::acquire(ip_address const& ip) {
+    auto const group = address_manager::netgroup(ip);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto& ip_count = ips_[ip];
+    auto& group_count = groups_[group];
+
+    if ((ip_limit_ != 0 && ip_count >= ip_limit_) ||
+        (group_limit_ != 0 && group_count >= group_limit_)) {
+
+        // Do not retain entries created by the lookup.
+        if (ip_count == 0) {
+            ips_.erase(ip);
+        }
+
+        if (group_count == 0) {
+            groups_.erase(group);
+        }
+
+        return false;
+    }
+
+    ++ip_count;
+    ++group_count;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void connection_slots::release(ip_address const& ip) {
+    auto const group = address_manager::netgroup(ip);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto const ip_it = ips_.find(ip);
+
+    if (ip_it != ips_.end() && --ip_it->second == 0) {
+        ips_.erase(ip_it);
+    }
+
+    auto const group_it = groups_.find(group);
+
+    if (group_it != groups_.end() && --group_it->second == 0) {
+        groups_.erase(group_it);
+    }
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace kth::network
@@ -0,0 +1,59 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/connection_statistics.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+namespace kth::network {
+
+// Counters are independent, so no ordering is required among them.
+static auto const relaxed = std::memory_order_relaxed;
+
+connection_statistics::connection_statistics()
+    : succeeded_(0)
+    , failed_(0)
+    , handshake_milliseconds_(0)
+{
+    for (auto& bucket: handshakes_) {
+        bucket.store(0, relaxed);
+    }
+}
+
+void connection_statistics::succeeded() {
+    succeeded_.fetch_add(1, relaxed);
+}
+
+void connection_statistics::failed() {
+    failed_.fetch_add(1, relaxed);
+}
+
+void connection_statistics::handshake(std::chrono::milliseconds latency) {
+    auto const value = static_cast<uint64_t>(std::max(latency.count(), decltype(latency.count())(0)));
+    auto const bound = std::lower_bound(bucket_milliseconds.begin(), bucket_milliseconds.end(), value);
+    auto const bucket = static_cast<size_t>(std::distance(bucket_milliseconds.begin(), bound));
+
+    handshakes_[bucket].fetch_add(1, relaxed);
+    handshake_milliseconds_.fetch_add(value, relaxed);
+}
+
+connection_statistics::snapshot_type connection_statistics::snapshot() const {
+    snapshot_type out{};
+    out.succeeded = succeeded_.load(relaxed);
+    out.failed = failed_.load(relaxed);
+    out.handshake_milliseconds = handshake_milliseconds_.load(relaxed);
+
+    for (size_t bucket = 0; bucket < handshakes_.size(); ++bucket) {
+        out.handshakes[bucket] = handshakes_[bucket].load(relaxed);
+    }
+
+    return out;
+}
+
+} // namespace kth::network
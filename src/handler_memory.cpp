@@ -0,0 +1,40 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/handler_memory.hpp>
+
+#include <cstddef>
+#include <new>
+
+namespace kth::network {
+
+handler_memory::handler_memory()
+    : in_use_(false)
+    , heap_allocations_(0)
+{}
+
+void* handler_memory::allocate(size_t size) {
+    if ( ! in_use_ && size <= capacity) {
+        in_use_ = true;
+        return storage_;
+    }
+
+    ++heap_allocations_;
+    return ::operator new(size);
+}
+
+void handler_memory::deallocate(void* pointer) {
+    if (pointer == storage_) {
+        in_use_ = false;
+        return;
+    }
+
+    ::operator delete(pointer);
+}
+
+size_t handler_memory::heap_allocations() const {
+    return heap_allocations_;
+}
+
+} // namespace kth::network
@@ -5,42 +5,104 @@
 #include <kth/network/hosts.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <string>
+#include <system_error>
 #include <vector>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <kth/domain.hpp>
+#include <kth/network/address_manager.hpp>
 #include <kth/network/settings.hpp>
 
 namespace kth::network {
 
 using namespace kth::config;
+using namespace kd::message;
+namespace interprocess = boost::interprocess;
 
 #define NAME "hosts"
 
-// TODO: change to network_address bimap hash table with services and age.
+// Binary hosts file identification ("KTHH").
+static uint32_t const file_magic = 0x4848544b;
+static uint32_t const file_version = 1;
+static size_t const file_header_size = 4 + 4 + 4;
+static size_t const file_record_size = 4 + 8 + 16 + 2 + 8 + 4 + 4 + 4 + 1;
+
+template <typename Integer>
+static
+Integer read_little_endian(uint8_t const* data) {
+    Integer value = 0;
+    for (size_t byte = 0; byte < sizeof(Integer); ++byte) {
+        value |= Integer(data[byte]) << (8 * byte);
+    }
+    return value;
+}
+
+template <typename Integer>
+static
+void write_little_endian(uint8_t* data, Integer value) {
+    for (size_t byte = 0; byte < sizeof(Integer); ++byte) {
+        data[byte] = uint8_t(value >> (8 * byte));
+    }
+}
+
+static
+address_manager::entry read_entry(uint8_t const* data) {
+    ip_address ip;
+    std::copy_n(data + 12, ip.size(), ip.begin());
+
+    return {
+        { read_little_endian<uint32_t>(data), read_little_endian<uint64_t>(data + 4), ip, read_little_endian<uint16_t>(data + 28) },
+        read_little_endian<uint64_t>(data + 30),
+        read_little_endian<uint32_t>(data + 38),
+        read_little_endian<uint32_t>(data + 42),
+        read_little_endian<uint32_t>(data + 46),
+        data[50] != 0
+    };
+}
+
+static
+void write_entry(uint8_t* data, address_manager::entry const& entry) {
+    auto const& ip = entry.host.ip();
+    write_little_endian<uint32_t>(data, entry.host.timestamp());
+    write_little_endian<uint64_t>(data + 4, entry.host.services());
+    std::copy(ip.begin(), ip.end(), data + 12);
+    write_little_endian<uint16_t>(data + 28, entry.host.port());
+    write_little_endian<uint64_t>(data + 30, entry.source_group);
+    write_little_endian<uint32_t>(data + 38, entry.last_success);
+    write_little_endian<uint32_t>(data + 42, entry.last_attempt);
+    write_little_endian<uint32_t>(data + 46, entry.failures);
+    data[50] = entry.tried ? 1 : 0;
+}
+
+static
+uint32_t now() {
+    using namespace std::chrono;
+    auto const seconds = duration_cast<std::chrono::seconds>(system_clock::now().time_since_epoch());
+    return static_cast<uint32_t>(seconds.count());
+}
+
 hosts::hosts(settings const& settings)
     : capacity_(std::min(max_address, static_cast<size_t>(settings.host_pool_capacity)))
-    , buffer_(std::max(capacity_, static_cast<size_t>(1u)))
+    , manager_(capacity_)
     , stopped_(true)
+    , snapshots_(0)
+    , written_(0)
     , file_path_(settings.hosts_file)
     , disabled_(capacity_ == 0)
 {}
 
-// private
-hosts::iterator hosts::find(address const& host) {
-    auto const found = [&host](address const& entry) {
-        return entry.port() == host.port() && entry.ip() == host.ip();
-    };
-
-    return std::find_if(buffer_.begin(), buffer_.end(), found);
-}
-
 size_t hosts::count() const {
     // Critical Section
     ///////////////////////////////////////////////////////////////////////////
     shared_lock lock(mutex_);
 
-    return buffer_.size();
+    return manager_.size();
     ///////////////////////////////////////////////////////////////////////////
 }
 
@@ -57,14 +119,11 @@ code hosts::fetch(address& out) const {
         return error::service_stopped;
     }
 
-    if (buffer_.empty()) {
+    // Select an address, favoring those that have accepted connections.
+    if ( ! manager_.select(out, now())) {
         return error::not_found;
     }
 
-    // Randomly select an address from the buffer.
-    auto const random = pseudo_random_broken_do_not_use::next(0, buffer_.size() - 1);
-    auto const index = static_cast<size_t>(random);
-    out = buffer_[index];
     return error::success;
     ///////////////////////////////////////////////////////////////////////////
 }
@@ -83,20 +142,17 @@ code hosts::fetch(address::list& out) const {
             return error::service_stopped;
         }
 
-        if (buffer_.empty()) {
+        if (manager_.empty()) {
             return error::not_found;
         }
 
-        auto const out_count = std::min(buffer_.size(), capacity_) / static_cast<size_t>(pseudo_random_broken_do_not_use::next(1, 20));
+        auto const out_count = std::min(manager_.size(), capacity_) / static_cast<size_t>(pseudo_random_broken_do_not_use::next(1, 20));
 
         if (out_count == 0) {
             return error::success;
         }
 
-        out.reserve(out_count);
-        for (size_t index = 0; index < out_count; ++index) {
-            out.push_back(buffer_[index]);
-        }
+        manager_.copy(out, out_count);
     }
     ///////////////////////////////////////////////////////////////////////////
 
@@ -123,40 +179,34 @@ code hosts::start() {
     mutex_.unlock_upgrade_and_lock();
     //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
     stopped_ = false;
-    kth::ifstream file(file_path_.string());
-    auto const file_error = file.bad();
-
-    if ( ! file_error) {
-        std::string line;
+    auto const ec = load();
 
-        while (std::getline(file, line)) {
-            // TODO: create full space-delimited network_address serialization.
-            // Use to/from string format as opposed to wire serialization.
-            infrastructure::config::authority host(line);
-
-            if (host.port() != 0) {
-                buffer_.push_back(host.to_network_address());
-            }
-        }
+    // Nothing read from an unreadable file is kept.
+    if (ec) {
+        manager_.clear();
     }
 
     mutex_.unlock();
     ///////////////////////////////////////////////////////////////////////////
 
-    if (file_error) {
-        LOG_DEBUG(LOG_NETWORK, "Failed to save hosts file.");
-        return error::file_system;
+    // The file is a disposable cache, so it never prevents start.
+    if (ec) {
+        LOG_WARNING(LOG_NETWORK, "Discarding unreadable hosts file: ", ec.message());
+        discard();
     }
 
     return error::success;
 }
 
-// load
+// save
 code hosts::stop() {
     if (disabled_) {
         return error::success;
     }
 
+    address_manager::entries entries;
+    uint64_t generation;
+
     // Critical Section
     ///////////////////////////////////////////////////////////////////////////
     mutex_.lock_upgrade();
@@ -170,28 +220,213 @@ code hosts::stop() {
     mutex_.unlock_upgrade_and_lock();
     //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
     stopped_ = true;
-    kth::ofstream file(file_path_.string());
-    auto const file_error = file.bad();
-
-    if ( ! file_error) {
-        for (auto const& entry: buffer_) {
-            // TODO: create full space-delimited network_address serialization.
-            // Use to/from string format as opposed to wire serialization.
-            file << infrastructure::config::authority(entry) << std::endl;
+    entries = manager_.snapshot();
+    generation = ++snapshots_;
+    manager_.clear();
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    // The file is written outside of the critical section.
+    auto const ec = save(entries, generation);
+
+    if (ec) {
+        LOG_DEBUG(LOG_NETWORK, "Failed to save hosts file.");
+        return ec;
+    }
+
+    return error::success;
+}
+
+code hosts::checkpoint() {
+    if (disabled_) {
+        return error::success;
+    }
+
+    address_manager::entries entries;
+    uint64_t generation;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    {
+        shared_lock lock(mutex_);
+
+        if (stopped_) {
+            return error::service_stopped;
         }
 
-        buffer_.clear();
+        entries = manager_.snapshot();
+        generation = ++snapshots_;
     }
+    ///////////////////////////////////////////////////////////////////////////
 
-    mutex_.unlock();
+    // Store and fetch are not blocked while the file is written.
+    auto const ec = save(entries, generation);
+
+    if (ec) {
+        LOG_DEBUG(LOG_NETWORK, "Failed to checkpoint hosts file.");
+        return ec;
+    }
+
+    return error::success;
+}
+
+// File format.
+// ----------------------------------------------------------------------------
+// All integers are little endian. A file that does not begin with the magic is
+// read as the legacy line-oriented authority format.
+//
+//  header: [magic:4][version:4][count:4]
+//  record: [timestamp:4][services:8][ip:16][port:2]
+//          [source_group:8][last_success:4][last_attempt:4][failures:4][tried:1]
+
+// private
+// Must be called with an exclusive lock held.
+code hosts::load() {
+    std::error_code file_error;
+    auto const size = std::filesystem::file_size(file_path_, file_error);
+
+    // A missing or empty file is not an error, the pool is just not seeded.
+    if (file_error || size == 0) {
+        return error::success;
+    }
+
+    try {
+        interprocess::file_mapping const mapping(file_path_.string().c_str(), interprocess::read_only);
+        interprocess::mapped_region const region(mapping, interprocess::read_only);
+        auto const begin = static_cast<uint8_t const*>(region.get_address());
+        auto const end = begin + region.get_size();
+
+        if (region.get_size() < file_header_size || read_little_endian<uint32_t>(begin) != file_magic) {
+            return load_legacy();
+        }
+
+        if (read_little_endian<uint32_t>(begin + 4) != file_version) {
+            return error::file_system;
+        }
+
+        auto const count = read_little_endian<uint32_t>(begin + 8);
+
+        if (size_t(end - begin - file_header_size) / file_record_size < count) {
+            return error::file_system;
+        }
+
+        auto it = begin + file_header_size;
+
+        for (uint32_t index = 0; index < count; ++index, it += file_record_size) {
+            manager_.restore(read_entry(it));
+        }
+    } catch (interprocess::interprocess_exception const&) {
+        return error::file_system;
+    }
+
+    return error::success;
+}
+
+// private
+// Must be called with an exclusive lock held.
+code hosts::load_legacy() {
+    kth::ifstream file(file_path_.string());
+
+    if (file.bad()) {
+        return error::file_system;
+    }
+
+    // The file records no sources, so its addresses share those of one
+    // unknown source rather than each taking buckets of its own.
+    address const source{};
+    std::string line;
+
+    while (std::getline(file, line)) {
+        infrastructure::config::authority host(line);
+
+        if (host.port() != 0) {
+            manager_.add(host.to_network_address(), source);
+        }
+    }
+
+    return error::success;
+}
+
+// private
+void hosts::discard() const {
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(file_mutex_);
+
+    std::error_code file_error;
+    std::filesystem::remove(file_path_, file_error);
     ///////////////////////////////////////////////////////////////////////////
+}
+
+// private
+// Write to a temporary file and rename it over the target, so that a failed
+// write never leaves a truncated hosts file behind. The temporary file is
+// written through a mapping and flushed to disk before the rename, so that
+// a crash cannot leave the renamed file empty or partly written. A snapshot
+// older than the last one written (a checkpoint overtaken by stop) is dropped.
+code hosts::save(address_manager::entries const& entries, uint64_t generation) const {
+    data_chunk data(file_header_size + entries.size() * file_record_size);
+    auto it = data.data();
+
+    write_little_endian<uint32_t>(it, file_magic);
+    write_little_endian<uint32_t>(it + 4, file_version);
+    write_little_endian<uint32_t>(it + 8, static_cast<uint32_t>(entries.size()));
+    it += file_header_size;
+
+    for (auto const& entry: entries) {
+        write_entry(it, entry);
+        it += file_record_size;
+    }
+
+    auto temporary = file_path_;
+    temporary += ".tmp";
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(file_mutex_);
+
+    if (generation < written_) {
+        return error::success;
+    }
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+        if ( ! file) {
+            return error::file_system;
+        }
+    }
+
+    std::error_code file_error;
+    std::filesystem::resize_file(temporary, data.size(), file_error);
+
+    if (file_error) {
+        return error::file_system;
+    }
+
+    try {
+        interprocess::file_mapping const mapping(temporary.string().c_str(), interprocess::read_write);
+        interprocess::mapped_region region(mapping, interprocess::read_write);
+        std::copy(data.begin(), data.end(), static_cast<uint8_t*>(region.get_address()));
+
+        // Synchronous flush, returns once the contents are on disk.
+        if ( ! region.flush(0, 0, false)) {
+            return error::file_system;
+        }
+    } catch (interprocess::interprocess_exception const&) {
+        return error::file_system;
+    }
+
+    std::filesystem::rename(temporary, file_path_, file_error);
 
     if (file_error) {
-        LOG_DEBUG(LOG_NETWORK, "Failed to load hosts file.");
         return error::file_system;
     }
 
+    written_ = generation;
     return error::success;
+    ///////////////////////////////////////////////////////////////////////////
 }
 
 code hosts::remove(address const& host) {
@@ -209,12 +444,10 @@ code hosts::remove(address const& host) {
         return error::service_stopped;
     }
 
-    auto it = find(host);
-
-    if (it != buffer_.end()) {
+    if (manager_.exists(host)) {
         mutex_.unlock_upgrade_and_lock();
         //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-        buffer_.erase(it);
+        manager_.remove(host);
 
         mutex_.unlock();
         //---------------------------------------------------------------------
@@ -227,7 +460,7 @@ code hosts::remove(address const& host) {
     return error::not_found;
 }
 
-code hosts::store(address const& host) {
+code hosts::store(address const& host, address const& source) {
     if (disabled_) {
         return error::success;
     }
@@ -248,27 +481,19 @@ code hosts::store(address const& host) {
         return error::service_stopped;
     }
 
-    if (find(host) == buffer_.end()) {
-        mutex_.unlock_upgrade_and_lock();
-        //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-        buffer_.push_back(host);
+    mutex_.unlock_upgrade_and_lock();
+    //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-        mutex_.unlock();
-        //---------------------------------------------------------------------
-        return error::success;
-    }
+    // Placement is by the netgroup of the source, redundant addresses only refresh.
+    manager_.add(host, source);
 
-    mutex_.unlock_upgrade();
+    mutex_.unlock();
     ///////////////////////////////////////////////////////////////////////////
 
-    ////// We don't treat redundant address as an error, just log it.
-    ////LOG_DEBUG(LOG_NETWORK
-    ////   , "Redundant host address [", authority(host), "] from peer.");
-
     return error::success;
 }
 
-void hosts::store(address::list const& hosts, result_handler handler) {
+void hosts::store(address::list const& hosts, address const& source, result_handler handler) {
     if (disabled_ || hosts.empty()) {
         handler(error::success);
         return;
@@ -286,12 +511,12 @@ void hosts::store(address::list const& hosts, result_handler handler) {
     }
 
     // Accept between 1 and all of this peer's addresses up to capacity.
-    auto const capacity = buffer_.capacity();
+    auto const capacity = capacity_;
     auto const usable = std::min(hosts.size(), capacity);
     auto const random = static_cast<size_t>(pseudo_random_broken_do_not_use::next(1, usable));
 
     // But always accept at least the amount we are short if available.
-    auto const gap = capacity - buffer_.size();
+    auto const gap = capacity - std::min(manager_.size(), capacity);
     auto const accept = std::max(gap, random);
 
     // Convert minimum desired to step for iteration, no less than 1.
@@ -312,10 +537,9 @@ void hosts::store(address::list const& hosts, result_handler handler) {
             continue;
         }
 
-        // Do not allow duplicates in the host cache.
-        if (find(host) == buffer_.end()) {
+        // Duplicates only refresh the services and timestamp of the entry.
+        if (manager_.add(host, source)) {
             ++accepted;
-            buffer_.push_back(host);
         }
     }
 
@@ -329,4 +553,50 @@ void hosts::store(address::list const& hosts, result_handler handler) {
     handler(error::success);
 }
 
-} // namespace kth::network
\ No newline at end of file
+code hosts::attempt(address const& host) {
+    if (disabled_) {
+        return error::success;
+    }
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+
+    if (stopped_) {
+        mutex_.unlock();
+        //---------------------------------------------------------------------
+        return error::service_stopped;
+    }
+
+    manager_.attempt(host, now());
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    return error::success;
+}
+
+code hosts::good(address const& host) {
+    if (disabled_) {
+        return error::success;
+    }
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+
+    if (stopped_) {
+        mutex_.unlock();
+        //---------------------------------------------------------------------
+        return error::service_stopped;
+    }
+
+    manager_.good(host, now());
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    return error::success;
+}
+
+} // namespace kth::network
@@ -0,0 +1,67 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/inbound_admission.hpp>
+
+#include <cstddef>
+#include <kth/domain.hpp>
+
+namespace kth::network {
+
+inbound_admission::inbound_admission(size_t ip_limit, size_t group_limit,
+    size_t handshake_limit, size_t rate, size_t burst)
+    : slots_(ip_limit, group_limit)
+    , accepts_(rate, burst)
+    , handshake_limit_(handshake_limit)
+    , handshakes_(0)
+{}
+
+inbound_admission::result inbound_admission::admit(ip_address const& ip) {
+    return admit(ip, token_bucket::clock::now());
+}
+
+inbound_admission::result inbound_admission::admit(ip_address const& ip, token_bucket::clock::time_point now) {
+    if ( ! slots_.acquire(ip)) {
+        return result::address_limit;
+    }
+
+    if ( ! begin_handshake()) {
+        slots_.release(ip);
+        return result::handshake_limit;
+    }
+
+    // A token is taken only by a connection that is otherwise admitted.
+    if ( ! accepts_.consume(now)) {
+        end_handshake();
+        slots_.release(ip);
+        return result::rate_limit;
+    }
+
+    return result::admitted;
+}
+
+void inbound_admission::end_handshake() {
+    --handshakes_;
+}
+
+void inbound_admission::release(ip_address const& ip) {
+    slots_.release(ip);
+}
+
+size_t inbound_admission::handshakes() const {
+    return handshakes_;
+}
+
+// private
+// Zero limit is unlimited.
+bool inbound_admission::begin_handshake() {
+    if (++handshakes_ <= handshake_limit_ || handshake_limit_ == 0) {
+        return true;
+    }
+
+    --handshakes_;
+    return false;
+}
+
+} // namespace kth::network
@@ -0,0 +1,102 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/message_metrics.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <kth/domain.hpp>
+
+namespace kth::network {
+
+using namespace kd::message;
+
+// Counters are independent, so no ordering is required among them.
+static auto const relaxed = std::memory_order_relaxed;
+
+message_statistics& message_statistics::operator+=(message_statistics const& other) {
+    received += other.received;
+    received_bytes += other.received_bytes;
+    sent += other.sent;
+    sent_bytes += other.sent_bytes;
+    parse_nanoseconds += other.parse_nanoseconds;
+    checksum_failures += other.checksum_failures;
+    return *this;
+}
+
+message_metrics::message_metrics() {
+    for (auto& entry: counters_) {
+        entry.received.store(0, relaxed);
+        entry.received_bytes.store(0, relaxed);
+        entry.sent.store(0, relaxed);
+        entry.sent_bytes.store(0, relaxed);
+        entry.parse_nanoseconds.store(0, relaxed);
+        entry.checksum_failures.store(0, relaxed);
+    }
+}
+
+message_type message_metrics::type(size_t index) {
+    return static_cast<message_type>(index);
+}
+
+std::string message_metrics::command(size_t index) {
+    std::string out{ "unknown" };
+
+    [&]<typename... Entries>(message_list<Entries...>) {
+        ((static_cast<size_t>(Entries::type) == index ? (out = Entries::message::command, true) : false) || ...);
+    }(subscribable_messages{});
+
+    return out;
+}
+
+// Types without a message in the table, such as xverack, share the unknown
+// entry, so that they are reported as a single series.
+static constexpr auto listed = []<typename... Entries>(message_list<Entries...>) {
+    std::array<bool, message_metrics::size> out{};
+    ((out[static_cast<size_t>(Entries::type)] = true), ...);
+    return out;
+}(subscribable_messages{});
+
+// private
+size_t message_metrics::index(message_type type) {
+    auto const value = static_cast<size_t>(type);
+    return value < size && listed[value] ? value : static_cast<size_t>(message_type::unknown);
+}
+
+void message_metrics::received(message_type type, size_t bytes, std::chrono::nanoseconds parse) {
+    auto& entry = counters_[index(type)];
+    entry.received.fetch_add(1, relaxed);
+    entry.received_bytes.fetch_add(bytes, relaxed);
+    entry.parse_nanoseconds.fetch_add(static_cast<uint64_t>(parse.count()), relaxed);
+}
+
+void message_metrics::sent(message_type type, size_t bytes) {
+    auto& entry = counters_[index(type)];
+    entry.sent.fetch_add(1, relaxed);
+    entry.sent_bytes.fetch_add(bytes, relaxed);
+}
+
+void message_metrics::checksum_failure(message_type type) {
+    counters_[index(type)].checksum_failures.fetch_add(1, relaxed);
+}
+
+void message_metrics::accumulate(table& out) const {
+    for (size_t index = 0; index < size; ++index) {
+        auto const& entry = counters_[index];
+        out[index] += message_statistics{
+            entry.received.load(relaxed),
+            entry.received_bytes.load(relaxed),
+            entry.sent.load(relaxed),
+            entry.sent_bytes.load(relaxed),
+            entry.parse_nanoseconds.load(relaxed),
+            entry.checksum_failures.load(relaxed)
+        };
+    }
+}
+
+} // namespace kth::network
@@ -4,199 +4,162 @@
 
 #include <kth/network/message_subscriber.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <istream>
 #include <memory>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <kth/domain.hpp>
 
-#define INITIALIZE_SUBSCRIBER(pool, value) value##_subscriber_(std::make_shared<value##_subscriber_type>(pool, #value "_sub"))
-#define RELAY_CODE(code, value) value##_subscriber_->relay(code, {})
+namespace kth::network {
+
+using namespace domain::message;
 
-// This allows us to block the peer while handling the message.
-#define CASE_HANDLE_MESSAGE(reader, version, value) \
-    case message_type::value: \
-        return handle<domain::message::value>(reader, version, value##_subscriber_)
+// Dispatch policy.
+// ----------------------------------------------------------------------------
 
-#define CASE_RELAY_MESSAGE(reader, version, value) \
-    case message_type::value: \
-        return relay<domain::message::value>(reader, version, value##_subscriber_)
+dispatch_policy::dispatch_policy() {
+    for (auto& mode: modes_) {
+        mode.store(dispatch_mode::relay, std::memory_order_relaxed);
+    }
 
-#define START_SUBSCRIBER(value) value##_subscriber_->start()
+    [this]<typename... Entries>(message_list<Entries...>) {
+        ((modes_[static_cast<size_t>(Entries::type)].store(Entries::handle ?
+            dispatch_mode::handle : dispatch_mode::relay, std::memory_order_relaxed)), ...);
+    }(subscribable_messages{});
+}
 
-#define STOP_SUBSCRIBER(value) value##_subscriber_->stop()
+dispatch_mode dispatch_policy::mode(message_type type) const {
+    auto const index = static_cast<size_t>(type);
+    return index < modes_.size() ? modes_[index].load(std::memory_order_relaxed) : dispatch_mode::relay;
+}
 
-namespace kth::network {
+void dispatch_policy::set_mode(message_type type, dispatch_mode mode) {
+    auto const index = static_cast<size_t>(type);
 
-using namespace domain::message;
+    if (index < modes_.size()) {
+        modes_[index].store(mode, std::memory_order_relaxed);
+    }
+}
+
+// Message subscriber.
+// ----------------------------------------------------------------------------
+
+// Channels not given a shared policy use the defaults.
+static
+dispatch_policy::ptr default_dispatch_policy() {
+    static auto const instance = std::make_shared<dispatch_policy>();
+    return instance;
+}
 
-message_subscriber::message_subscriber(threadpool& pool)
-    : INITIALIZE_SUBSCRIBER(pool, address)
-    , INITIALIZE_SUBSCRIBER(pool, alert)
-    , INITIALIZE_SUBSCRIBER(pool, block)
-    , INITIALIZE_SUBSCRIBER(pool, block_transactions)
-    , INITIALIZE_SUBSCRIBER(pool, compact_block)
-    , INITIALIZE_SUBSCRIBER(pool, double_spend_proof)
-    , INITIALIZE_SUBSCRIBER(pool, fee_filter)
-    , INITIALIZE_SUBSCRIBER(pool, filter_add)
-    , INITIALIZE_SUBSCRIBER(pool, filter_clear)
-    , INITIALIZE_SUBSCRIBER(pool, filter_load)
-    , INITIALIZE_SUBSCRIBER(pool, get_address)
-    , INITIALIZE_SUBSCRIBER(pool, get_blocks)
-    , INITIALIZE_SUBSCRIBER(pool, get_block_transactions)
-    , INITIALIZE_SUBSCRIBER(pool, get_data)
-    , INITIALIZE_SUBSCRIBER(pool, get_headers)
-    , INITIALIZE_SUBSCRIBER(pool, headers)
-    , INITIALIZE_SUBSCRIBER(pool, inventory)
-    , INITIALIZE_SUBSCRIBER(pool, memory_pool)
-    , INITIALIZE_SUBSCRIBER(pool, merkle_block)
-    , INITIALIZE_SUBSCRIBER(pool, not_found)
-    , INITIALIZE_SUBSCRIBER(pool, ping)
-    , INITIALIZE_SUBSCRIBER(pool, pong)
-    , INITIALIZE_SUBSCRIBER(pool, reject)
-    , INITIALIZE_SUBSCRIBER(pool, send_compact)
-    , INITIALIZE_SUBSCRIBER(pool, send_headers)
-    , INITIALIZE_SUBSCRIBER(pool, transaction)
-    , INITIALIZE_SUBSCRIBER(pool, verack)
-    , INITIALIZE_SUBSCRIBER(pool, version)
-    , INITIALIZE_SUBSCRIBER(pool, xversion)
-    // , INITIALIZE_SUBSCRIBER(pool, xverack)
+message_subscriber::message_subscriber(threadpool& pool, unsubscribed_policy policy)
+    : pool_(pool)
+    , unsubscribed_(policy)
+    , dispatch_(default_dispatch_policy())
+    , handlers_(std::make_shared<handler_counts>())
+    , stopped_(true)
 {}
 
 void message_subscriber::broadcast(code const& ec) {
-    RELAY_CODE(ec, address);
-    RELAY_CODE(ec, alert);
-    RELAY_CODE(ec, block);
-    RELAY_CODE(ec, block_transactions);
-    RELAY_CODE(ec, compact_block);
-    RELAY_CODE(ec, double_spend_proof);
-    RELAY_CODE(ec, fee_filter);
-    RELAY_CODE(ec, filter_add);
-    RELAY_CODE(ec, filter_clear);
-    RELAY_CODE(ec, filter_load);
-    RELAY_CODE(ec, get_address);
-    RELAY_CODE(ec, get_blocks);
-    RELAY_CODE(ec, get_block_transactions);
-    RELAY_CODE(ec, get_data);
-    RELAY_CODE(ec, get_headers);
-    RELAY_CODE(ec, headers);
-    RELAY_CODE(ec, inventory);
-    RELAY_CODE(ec, memory_pool);
-    RELAY_CODE(ec, merkle_block);
-    RELAY_CODE(ec, not_found);
-    RELAY_CODE(ec, ping);
-    RELAY_CODE(ec, pong);
-    RELAY_CODE(ec, reject);
-    RELAY_CODE(ec, send_compact);
-    RELAY_CODE(ec, send_headers);
-    RELAY_CODE(ec, transaction);
-    RELAY_CODE(ec, verack);
-    RELAY_CODE(ec, version);
-    RELAY_CODE(ec, xversion);
-    // RELAY_CODE(ec, xverack);
+    // Copy the subscribers so that relay is not invoked under the lock.
+    auto const copy = [this] {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        shared_lock lock(mutex_);
+        return subscribers_;
+        ///////////////////////////////////////////////////////////////////////
+    }();
+
+    std::apply([&ec](auto const&... subscriber) {
+        ((subscriber ? subscriber->relay(ec, {}) : void()), ...);
+    }, copy);
+}
+
+// Live handlers are checked before parsing, so that with the skip policy a
+// message nobody listens for costs no allocation. The payload size has
+// already been bounded by the heading.
+template <typename Entry>
+code message_subscriber::dispatch(byte_reader& reader, uint32_t version) const {
+    using message = typename Entry::message;
+    auto const subscriber = find<message>();
+
+    if ( ! subscriber || ! has_handlers<message>()) {
+        switch (unsubscribed_) {
+            case unsubscribed_policy::reject:
+                if ( ! handshake_message(Entry::type)) {
+                    return error::not_found;
+                }
+                [[fallthrough]];
+            case unsubscribed_policy::skip:
+                return reader.skip(reader.remaining_size()) ? error::success : error::bad_stream;
+            case unsubscribed_policy::parse:
+            default:
+                return message::from_data(reader, version) ? error::success : error::bad_stream;
+        }
+    }
+
+    // This allows us to block the peer while handling the message.
+    if (dispatch_->mode(Entry::type) == dispatch_mode::handle) {
+        return handle<message>(reader, version, subscriber);
+    } else {
+        return relay<message>(reader, version, subscriber);
+    }
+}
+
+// Message type identifiers index a table of loaders, gaps are null.
+template <typename... Entries>
+constexpr auto message_subscriber::make_loaders(message_list<Entries...>) {
+    std::array<loader, message_type_limit(message_list<Entries...>{})> loaders{};
+    ((loaders[static_cast<size_t>(Entries::type)] = &message_subscriber::dispatch<Entries>), ...);
+    return loaders;
+}
+
+void message_subscriber::set_dispatch_policy(dispatch_policy::ptr policy) {
+    dispatch_ = std::move(policy);
 }
 
 code message_subscriber::load(message_type type, uint32_t version, byte_reader& reader) const {
-    switch (type) {
-        CASE_RELAY_MESSAGE(reader, version, address);
-        CASE_RELAY_MESSAGE(reader, version, alert);
-        CASE_HANDLE_MESSAGE(reader, version, block);
-        CASE_RELAY_MESSAGE(reader, version, block_transactions);
-        CASE_RELAY_MESSAGE(reader, version, compact_block);
-        CASE_RELAY_MESSAGE(reader, version, double_spend_proof);
-        CASE_RELAY_MESSAGE(reader, version, fee_filter);
-        CASE_RELAY_MESSAGE(reader, version, filter_add);
-        CASE_RELAY_MESSAGE(reader, version, filter_clear);
-        CASE_RELAY_MESSAGE(reader, version, filter_load);
-        CASE_RELAY_MESSAGE(reader, version, get_address);
-        CASE_RELAY_MESSAGE(reader, version, get_blocks);
-        CASE_RELAY_MESSAGE(reader, version, get_block_transactions);
-        CASE_RELAY_MESSAGE(reader, version, get_data);
-        CASE_RELAY_MESSAGE(reader, version, get_headers);
-        CASE_RELAY_MESSAGE(reader, version, headers);
-        CASE_RELAY_MESSAGE(reader, version, inventory);
-        CASE_RELAY_MESSAGE(reader, version, memory_pool);
-        CASE_RELAY_MESSAGE(reader, version, merkle_block);
-        CASE_RELAY_MESSAGE(reader, version, not_found);
-        CASE_RELAY_MESSAGE(reader, version, ping);
-        CASE_RELAY_MESSAGE(reader, version, pong);
-        CASE_RELAY_MESSAGE(reader, version, reject);
-        CASE_RELAY_MESSAGE(reader, version, send_compact);
-        CASE_RELAY_MESSAGE(reader, version, send_headers);
-        CASE_HANDLE_MESSAGE(reader, version, transaction);
-        CASE_HANDLE_MESSAGE(reader, version, verack);
-        CASE_HANDLE_MESSAGE(reader, version, version);
-        CASE_HANDLE_MESSAGE(reader, version, xversion);
-        // CASE_HANDLE_MESSAGE(reader, version, xverack);
-        case message_type::unknown:
-        default:
-            return error::not_found;
+    static constexpr auto loaders = make_loaders(subscribable_messages{});
+    auto const index = static_cast<size_t>(type);
+
+    if (index >= loaders.size() || loaders[index] == nullptr) {
+        return error::not_found;
     }
+
+    return (this->*loaders[index])(reader, version);
 }
 
 void message_subscriber::start() {
-    START_SUBSCRIBER(address);
-    START_SUBSCRIBER(alert);
-    START_SUBSCRIBER(block);
-    START_SUBSCRIBER(block_transactions);
-    START_SUBSCRIBER(compact_block);
-    START_SUBSCRIBER(double_spend_proof);
-    START_SUBSCRIBER(fee_filter);
-    START_SUBSCRIBER(filter_add);
-    START_SUBSCRIBER(filter_clear);
-    START_SUBSCRIBER(filter_load);
-    START_SUBSCRIBER(get_address);
-    START_SUBSCRIBER(get_blocks);
-    START_SUBSCRIBER(get_block_transactions);
-    START_SUBSCRIBER(get_data);
-    START_SUBSCRIBER(get_headers);
-    START_SUBSCRIBER(headers);
-    START_SUBSCRIBER(inventory);
-    START_SUBSCRIBER(memory_pool);
-    START_SUBSCRIBER(merkle_block);
-    START_SUBSCRIBER(not_found);
-    START_SUBSCRIBER(ping);
-    START_SUBSCRIBER(pong);
-    START_SUBSCRIBER(reject);
-    START_SUBSCRIBER(send_compact);
-    START_SUBSCRIBER(send_headers);
-    START_SUBSCRIBER(transaction);
-    START_SUBSCRIBER(verack);
-    START_SUBSCRIBER(version);
-    START_SUBSCRIBER(xversion);
-    // START_SUBSCRIBER(xverack);
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+
+    stopped_ = false;
+
+    std::apply([](auto const&... subscriber) {
+        ((subscriber ? subscriber->start() : void()), ...);
+    }, subscribers_);
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
 }
 
 void message_subscriber::stop() {
-    STOP_SUBSCRIBER(address);
-    STOP_SUBSCRIBER(alert);
-    STOP_SUBSCRIBER(block);
-    STOP_SUBSCRIBER(block_transactions);
-    STOP_SUBSCRIBER(compact_block);
-    STOP_SUBSCRIBER(double_spend_proof);
-    STOP_SUBSCRIBER(fee_filter);
-    STOP_SUBSCRIBER(filter_add);
-    STOP_SUBSCRIBER(filter_clear);
-    STOP_SUBSCRIBER(filter_load);
-    STOP_SUBSCRIBER(get_address);
-    STOP_SUBSCRIBER(get_blocks);
-    STOP_SUBSCRIBER(get_block_transactions);
-    STOP_SUBSCRIBER(get_data);
-    STOP_SUBSCRIBER(get_headers);
-    STOP_SUBSCRIBER(headers);
-    STOP_SUBSCRIBER(inventory);
-    STOP_SUBSCRIBER(memory_pool);
-    STOP_SUBSCRIBER(merkle_block);
-    STOP_SUBSCRIBER(not_found);
-    STOP_SUBSCRIBER(ping);
-    STOP_SUBSCRIBER(pong);
-    STOP_SUBSCRIBER(reject);
-    STOP_SUBSCRIBER(send_compact);
-    STOP_SUBSCRIBER(send_headers);
-    STOP_SUBSCRIBER(transaction);
-    STOP_SUBSCRIBER(verack);
-    STOP_SUBSCRIBER(version);
-    STOP_SUBSCRIBER(xversion);
-    // STOP_SUBSCRIBER(xverack);
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+
+    stopped_ = true;
+
+    std::apply([](auto const&... subscriber) {
+        ((subscriber ? subscriber->stop() : void()), ...);
+    }, subscribers_);
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
 }
 
 } // namespace kth::network
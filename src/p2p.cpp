@@ -8,7 +8,9 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -43,10 +45,16 @@ size_t nominal_connecting(settings const& settings) {
     return settings.peers.size() + settings.connect_batch_size * settings.outbound_connections;
 }
 
-// This can be exceeded due to manual connection calls and race conditions.
-inline
-size_t nominal_connected(settings const& settings) {
-    return settings.peers.size() + settings.outbound_connections + settings.inbound_connections;
+// Handshaking channels are found by version nonce, to detect loopback.
+static
+uint64_t nonce_of(channel::ptr const& channel) {
+    return channel->nonce();
+}
+
+// Connected channels are unique by authority.
+static
+infrastructure::config::authority authority_of(channel::ptr const& channel) {
+    return channel->authority();
 }
 
 p2p::p2p(settings const& settings)
@@ -55,9 +63,12 @@ p2p::p2p(settings const& settings)
     , top_block_({ null_hash, 0 })
     , hosts_(settings_)
     , pending_connect_(nominal_connecting(settings_))
-    , pending_handshake_(nominal_connected(settings_))
-    , pending_close_(nominal_connected(settings_))
+    , pending_handshake_(&nonce_of)
+    , pending_close_(&authority_of)
     , threadpool_("network")
+    , checkpoint_(std::make_shared<deadline>(threadpool_, settings_.host_pool_checkpoint()))
+    , dispatch_policy_(std::make_shared<dispatch_policy>())
+    , retired_metrics_{}
     , stop_subscriber_(std::make_shared<stop_subscriber>(threadpool_, NAME "_stop_sub"))
     , channel_subscriber_(std::make_shared<channel_subscriber>(threadpool_, NAME "_sub"))
 {}
@@ -76,12 +87,30 @@ void p2p::start(result_handler handler) {
         return;
     }
 
+#if ! defined(KTH_CURRENCY_BCH)
+    // Blocks are streamed in the legacy serialization, without witnesses.
+    if (settings_.streamed_blocks) {
+        LOG_ERROR(LOG_NETWORK, "Streamed blocks are only supported for BCH.");
+        handler(error::operation_failed);
+        return;
+    }
+#endif
+
+    // Blocked ranges apply from the first connection.
+    auto const ec = load_blacklist();
+
+    if (ec) {
+        handler(ec);
+        return;
+    }
+
     threadpool_.join();
     threadpool_.spawn(thread_default(settings_.threads), thread_priority::normal);
     stopped_ = false;
 
     stop_subscriber_->start();
     channel_subscriber_->start();
+    start_statistics();
 
     // This instance is retained by stop handler and member reference.
     manual_.store(attach_manual_session());
@@ -129,6 +158,9 @@ void p2p::handle_hosts_loaded(code const& ec, result_handler handler) {
         return;
     }
 
+    // Periodically persist the address pool so that a crash does not lose it.
+    start_checkpoint();
+
     // The instance is retained by the stop handler (until shutdown).
     auto const seed = attach_seed_session();
 
@@ -207,6 +239,62 @@ void p2p::handle_running(code const& ec, result_handler handler) {
     handler(error::success);
 }
 
+// Hosts checkpoint.
+// ----------------------------------------------------------------------------
+
+void p2p::start_checkpoint() {
+    if (stopped() || settings_.host_pool_checkpoint_minutes == 0 ||
+        settings_.host_pool_capacity == 0) {
+        return;
+    }
+
+    checkpoint_->start([this](code const& ec){
+        handle_checkpoint(ec);
+    });
+}
+
+void p2p::handle_checkpoint(code const& ec) {
+    // The timer is only canceled by stop, which sets stopped first.
+    if (stopped(ec)) {
+        return;
+    }
+
+    auto const result = checkpoint_hosts();
+
+    if (result && result != error::service_stopped) {
+        LOG_WARNING(LOG_NETWORK, "Error checkpointing host addresses: ", result.message());
+    }
+
+    start_checkpoint();
+}
+
+// The pool is copied under a shared lock and written outside of it.
+code p2p::checkpoint_hosts() {
+    return hosts_.checkpoint();
+}
+
+// The exporter is optional, a failure to bind does not prevent start.
+void p2p::start_statistics() {
+    auto const& authority = settings_.statistics_server;
+
+    if (authority.port() == 0) {
+        return;
+    }
+
+    auto const server = std::make_shared<statistics_server>(threadpool_,
+        [this]() { return statistics(); });
+
+    auto const ec = server->start(authority);
+
+    if (ec) {
+        LOG_WARNING(LOG_NETWORK, "Error starting statistics server [", authority, "] ", ec.message());
+        return;
+    }
+
+    LOG_INFO(LOG_NETWORK, "Serving statistics on [", authority, "]");
+    statistics_server_.store(server);
+}
+
 // Specializations.
 // ----------------------------------------------------------------------------
 // Create derived sessions and override these to inject from derived p2p class.
@@ -237,13 +325,24 @@ session_outbound::ptr p2p::attach_outbound_session() {
 // taken around the entire section, which poses a deadlock risk. Instead this
 // is thread safe and idempotent, allowing it to be unguarded.
 bool p2p::stop() {
+    // Signal all current work to stop, so the canceled checkpoint is not
+    // written or restarted once the final save is under way.
+    stopped_ = true;
+    checkpoint_->stop();
+
     // This is the only stop operation that can fail.
     auto const result = (hosts_.stop() == error::success);
 
-    // Signal all current work to stop and free manual session.
-    stopped_ = true;
+    // Free manual session.
     manual_.store({});
 
+    auto const server = statistics_server_.load();
+
+    if (server) {
+        server->stop();
+        statistics_server_.store({});
+    }
+
     // Prevent subscription after stop.
     stop_subscriber_->stop();
     stop_subscriber_->invoke(error::service_stopped);
@@ -297,10 +396,118 @@ bool p2p::stopped() const {
     return stopped_;
 }
 
+bool p2p::stopped(code const& ec) const {
+    return stopped() || ec == error::channel_stopped || ec == error::service_stopped;
+}
+
 threadpool& p2p::thread_pool() {
     return threadpool_;
 }
 
+connection_statistics& p2p::connections(session_kind kind) {
+    return connections_[static_cast<size_t>(kind)];
+}
+
+static std::string const session_names[] = { "seed", "manual", "inbound", "outbound" };
+
+std::string p2p::statistics() const {
+    std::ostringstream out;
+
+    out << "# HELP kth_network_connections Channels by connection state.\n"
+        << "# TYPE kth_network_connections gauge\n"
+        << "kth_network_connections{state=\"connecting\"} " << pending_connect_.size() << "\n"
+        << "kth_network_connections{state=\"handshaking\"} " << pending_handshake_.size() << "\n"
+        << "kth_network_connections{state=\"connected\"} " << pending_close_.size() << "\n";
+
+    out << "# HELP kth_network_hosts Addresses in the hosts pool.\n"
+        << "# TYPE kth_network_hosts gauge\n"
+        << "kth_network_hosts " << address_count() << "\n";
+
+    std::array<connection_statistics::snapshot_type, std::size(session_names)> sessions;
+
+    for (size_t kind = 0; kind < sessions.size(); ++kind) {
+        sessions[kind] = connections_[kind].snapshot();
+    }
+
+    out << "# HELP kth_network_connects_total Connection attempts by session and result.\n"
+        << "# TYPE kth_network_connects_total counter\n";
+
+    for (size_t kind = 0; kind < sessions.size(); ++kind) {
+        auto const& name = session_names[kind];
+        out << "kth_network_connects_total{session=\"" << name << "\",result=\"success\"} " << sessions[kind].succeeded << "\n"
+            << "kth_network_connects_total{session=\"" << name << "\",result=\"failure\"} " << sessions[kind].failed << "\n";
+    }
+
+    out << "# HELP kth_network_handshake_seconds Time from channel start to completed handshake.\n"
+        << "# TYPE kth_network_handshake_seconds histogram\n";
+
+    for (size_t kind = 0; kind < sessions.size(); ++kind) {
+        auto const& name = session_names[kind];
+        auto const& handshakes = sessions[kind].handshakes;
+        uint64_t cumulative = 0;
+
+        for (size_t bucket = 0; bucket < connection_statistics::bucket_milliseconds.size(); ++bucket) {
+            cumulative += handshakes[bucket];
+            out << "kth_network_handshake_seconds_bucket{session=\"" << name << "\",le=\""
+                << connection_statistics::bucket_milliseconds[bucket] / 1000.0 << "\"} " << cumulative << "\n";
+        }
+
+        cumulative += handshakes.back();
+        out << "kth_network_handshake_seconds_bucket{session=\"" << name << "\",le=\"+Inf\"} " << cumulative << "\n"
+            << "kth_network_handshake_seconds_sum{session=\"" << name << "\"} " << sessions[kind].handshake_milliseconds / 1000.0 << "\n"
+            << "kth_network_handshake_seconds_count{session=\"" << name << "\"} " << cumulative << "\n";
+    }
+
+    // Message types that have seen no traffic are omitted.
+    auto const totals = metrics();
+    auto const counter = [&](std::string const& name, std::string const& help, auto const& value) {
+        out << "# HELP " << name << " " << help << "\n"
+            << "# TYPE " << name << " counter\n";
+
+        for (size_t index = 0; index < totals.size(); ++index) {
+            auto const& entry = totals[index];
+
+            if (entry.received != 0 || entry.sent != 0 || entry.checksum_failures != 0) {
+                out << name << "{command=\"" << message_metrics::command(index) << "\"} " << value(entry) << "\n";
+            }
+        }
+    };
+
+    counter("kth_network_messages_received_total", "Messages received by command.",
+        [](message_statistics const& entry) { return entry.received; });
+    counter("kth_network_received_bytes_total", "Bytes received by command, including headings.",
+        [](message_statistics const& entry) { return entry.received_bytes; });
+    counter("kth_network_messages_sent_total", "Messages sent by command.",
+        [](message_statistics const& entry) { return entry.sent; });
+    counter("kth_network_sent_bytes_total", "Bytes sent by command, including headings.",
+        [](message_statistics const& entry) { return entry.sent_bytes; });
+    counter("kth_network_parse_seconds_total", "Time spent parsing and handling inline by command.",
+        [](message_statistics const& entry) { return entry.parse_nanoseconds / 1e9; });
+    counter("kth_network_checksum_failures_total", "Payload checksum failures by command.",
+        [](message_statistics const& entry) { return entry.checksum_failures; });
+
+    return out.str();
+}
+
+message_metrics::table p2p::metrics() const {
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+
+    auto totals = retired_metrics_;
+
+    for (auto const& channel: pending_close_.collection()) {
+        channel->metrics().accumulate(totals);
+    }
+
+    return totals;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+dispatch_policy::ptr p2p::message_dispatch_policy() const {
+    return dispatch_policy_;
+}
+
 // Send.
 // ----------------------------------------------------------------------------
 
@@ -360,13 +567,13 @@ size_t p2p::address_count() const {
     return hosts_.count();
 }
 
-code p2p::store(address const& address) {
-    return hosts_.store(address);
+code p2p::store(address const& address, address const& source) {
+    return hosts_.store(address, source);
 }
 
-void p2p::store(address::list const& addresses, result_handler handler) {
+void p2p::store(address::list const& addresses, address const& source, result_handler handler) {
     // Store is invoked on a new thread.
-    hosts_.store(addresses, handler);
+    hosts_.store(addresses, source, handler);
 }
 
 code p2p::fetch_address(address& out_address) const {
@@ -381,6 +588,42 @@ code p2p::remove(address const& address) {
     return hosts_.remove(address);
 }
 
+code p2p::attempt(address const& address) {
+    return hosts_.attempt(address);
+}
+
+code p2p::good(address const& address) {
+    return hosts_.good(address);
+}
+
+// Blacklist.
+// ----------------------------------------------------------------------------
+
+code p2p::load_blacklist() {
+    address_blacklist::ranges values;
+
+    for (auto const& blocked: settings_.blacklist) {
+        values.push_back(address_blacklist::single(blocked.to_network_address().ip()));
+    }
+
+    if ( ! settings_.blacklist_file.empty()) {
+        auto const ec = address_blacklist::read(settings_.blacklist_file, values);
+
+        if (ec) {
+            LOG_ERROR(LOG_NETWORK, "Error loading blacklist [", settings_.blacklist_file.string(), "] ", ec.message());
+            return ec;
+        }
+    }
+
+    blacklist_.assign(std::move(values));
+    LOG_INFO(LOG_NETWORK, "Blacklisted (", blacklist_.size(), ") address ranges.");
+    return error::success;
+}
+
+bool p2p::blacklisted(infrastructure::config::authority const& authority) const {
+    return blacklist_.blocked(authority.to_network_address().ip());
+}
+
 // Pending connect collection.
 // ----------------------------------------------------------------------------
 
@@ -405,11 +648,7 @@ void p2p::unpend(channel::ptr channel) {
 }
 
 bool p2p::pending(uint64_t version_nonce) const {
-    auto const match = [version_nonce](const channel::ptr& element) {
-        return element->nonce() == version_nonce;
-    };
-
-    return pending_handshake_.exists(match);
+    return pending_handshake_.exists(version_nonce);
 }
 
 // Pending close collection (open connections).
@@ -420,21 +659,12 @@ size_t p2p::connection_count() const {
 }
 
 bool p2p::connected(address const& address) const {
-    auto const match = [&address](const channel::ptr& element) {
-        return element->authority() == address;
-    };
-
-    return pending_close_.exists(match);
+    return pending_close_.exists(infrastructure::config::authority(address));
 }
 
 code p2p::store(channel::ptr channel) {
-    auto const address = channel->authority();
-    auto const match = [&address](const channel::ptr& element) {
-        return element->authority() == address;
-    };
-
     // May return error::address_in_use.
-    auto const ec = pending_close_.store(channel, match);
+    auto const ec = pending_close_.store(channel);
 
     if ( ! ec && channel->notify())
         channel_subscriber_->relay(error::success, channel);
@@ -442,8 +672,17 @@ code p2p::store(channel::ptr channel) {
     return ec;
 }
 
+// The counts of a closed channel are retained, under the lock so that a
+// concurrent metrics snapshot counts the channel exactly once.
 void p2p::remove(channel::ptr channel) {
-    pending_close_.remove(channel);
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+
+    if (pending_close_.remove(channel)) {
+        channel->metrics().accumulate(retired_metrics_);
+    }
+    ///////////////////////////////////////////////////////////////////////////
 }
 
 } // namespace kth::network
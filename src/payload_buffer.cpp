@@ -0,0 +1,64 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/payload_buffer.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <kth/domain.hpp>
+#include <kth/network/payload_pool.hpp>
+
+namespace kth::network {
+
+payload_buffer::payload_buffer(payload_pool::ptr pool)
+    : pool_(std::move(pool))
+    , small_payloads_(0)
+{}
+
+// Grow geometrically, the pool rounds up to a power of two.
+data_chunk& payload_buffer::reserve(size_t size) {
+    if ( ! buffer_ || buffer_->capacity() < size) {
+        auto const current = buffer_ ? buffer_->capacity() : 0;
+        auto const grown = std::max({ size, current * 2, minimum_capacity });
+        buffer_ = pool_->acquire(grown);
+    }
+
+    // This does not cause a reallocation.
+    buffer_->resize(size);
+    return *buffer_;
+}
+
+payload_pool::buffer_ptr const& payload_buffer::get() const {
+    return buffer_;
+}
+
+void payload_buffer::release() {
+    buffer_.reset();
+    small_payloads_ = 0;
+}
+
+void payload_buffer::parsed(size_t size) {
+    if ( ! buffer_) {
+        return;
+    }
+
+    auto const capacity = buffer_->capacity();
+
+    if (capacity > maximum_retained_capacity) {
+        release();
+        return;
+    }
+
+    if (capacity <= minimum_capacity || size > minimum_capacity) {
+        small_payloads_ = 0;
+        return;
+    }
+
+    if (++small_payloads_ >= shrink_count) {
+        release();
+    }
+}
+
+} // namespace kth::network
@@ -0,0 +1,124 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/payload_pool.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <kth/domain.hpp>
+
+namespace kth::network {
+
+// Each size class retains free buffers up to this many bytes (at least one).
+static size_t const class_budget = 2 * 1024 * 1024;
+
+// No size class retains more than this many free buffers.
+static size_t const maximum_class_buffers = 64;
+
+payload_pool::ptr payload_pool::instance() {
+    static auto const pool = std::make_shared<payload_pool>();
+    return pool;
+}
+
+payload_pool::payload_pool() {}
+
+// private
+size_t payload_pool::size_class(size_t size) {
+    size_t index = 0;
+
+    while (index < class_count && class_size(index) < size) {
+        ++index;
+    }
+
+    return index;
+}
+
+// private
+size_t payload_pool::class_size(size_t size_class) {
+    return size_t(1) << (minimum_class_bits + size_class);
+}
+
+// private
+size_t payload_pool::class_limit(size_t size_class) {
+    auto const buffers = class_budget / class_size(size_class);
+    return std::clamp(buffers, size_t(1), maximum_class_buffers);
+}
+
+payload_pool::buffer_ptr payload_pool::acquire(size_t size) {
+    auto const index = size_class(size);
+    data_chunk buffer;
+
+    // Sizes beyond the largest class are allocated exactly and not retained.
+    if (index < class_count) {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto& available = free_[index];
+
+        if ( ! available.empty()) {
+            buffer = std::move(available.back());
+            available.pop_back();
+        }
+        ///////////////////////////////////////////////////////////////////////
+
+        if (buffer.capacity() == 0) {
+            buffer.reserve(class_size(index));
+        }
+    }
+
+    buffer.resize(size);
+    return buffer_ptr(new data_chunk(std::move(buffer)), releaser{ weak_from_this() });
+}
+
+size_t payload_pool::retained() const {
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t count = 0;
+
+    for (auto const& available: free_) {
+        count += available.size();
+    }
+
+    return count;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// private
+void payload_pool::release(data_chunk&& buffer) {
+    // Buffers are filed by capacity, which is the size of their class.
+    auto const index = size_class(buffer.capacity());
+
+    if (index == class_count || class_size(index) != buffer.capacity()) {
+        return;
+    }
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto& available = free_[index];
+
+    if (available.size() < class_limit(index)) {
+        available.push_back(std::move(buffer));
+    }
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void payload_pool::releaser::operator()(data_chunk* buffer) const {
+    auto const owner = pool.lock();
+
+    if (owner) {
+        owner->release(std::move(*buffer));
+    }
+
+    delete buffer;
+}
+
+} // namespace kth::network
@@ -69,7 +69,7 @@ bool protocol_address_31402::handle_receive_address(code const& ec, address_cons
        , message->addresses().size(), ")");
 
     // TODO: manage timestamps (active channels are connected < 3 hours ago).
-    network_.store(message->addresses(), BIND1(handle_store_addresses, _1));
+    network_.store(message->addresses(), authority().to_network_address(), BIND1(handle_store_addresses, _1));
 
     // RESUBSCRIBE
     return true;
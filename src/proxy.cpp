@@ -4,47 +4,71 @@
 
 #include <kth/network/proxy.hpp>
 
-#define BOOST_BIND_NO_PLACEHOLDERS
-
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <span>
 #include <utility>
+#include <vector>
 #include <kth/domain.hpp>
+#include <kth/network/block_stream.hpp>
 #include <kth/network/define.hpp>
+#include <kth/network/handler_memory.hpp>
+#include <kth/network/payload_pool.hpp>
 #include <kth/network/settings.hpp>
 
 namespace kth::network {
 
 #define NAME "proxy"
 
-using namespace std::placeholders;
 using namespace ::asio;
 using namespace kd::message;
 
 // Dump up to 1k of payload as hex in order to diagnose failure.
 static size_t const invalid_payload_dump_size = 1024;
 
-// payload_buffer_ sizing assumes monotonically increasing size by version.
-// Initialize to pre-witness max payload and let grow to witness as required.
+// Size of the read buffer used by the buffered read cycle.
+static size_t const read_buffer_size = 64 * 1024;
+
+// With pipelined parsing, reading pauses once more than one payload and more
+// than this many bytes are waiting to be parsed.
+static size_t const maximum_pipelined_bytes = 8 * 1024 * 1024;
+
+// The payload buffer is borrowed from the shared pool (see payload_buffer).
 // The socket owns the single thread on which this channel reads and writes.
 proxy::proxy(threadpool& pool, socket::ptr socket, settings const& settings)
     : authority_(socket->authority())
     , heading_buffer_(heading::maximum_size())
-    , payload_buffer_(heading::maximum_payload_size(settings.protocol_maximum, settings.identifier, settings.inbound_port == 48333))
+    , payload_buffer_(payload_pool::instance())
+    , read_buffer_(settings.buffered_reads ? read_buffer_size : 0)
+    , read_begin_(0)
+    , read_end_(0)
     , maximum_payload_(heading::maximum_payload_size(settings.protocol_maximum, settings.identifier, settings.inbound_port == 48333))
     , socket_(socket)
     , stopped_(true)
     , protocol_magic_(settings.identifier)
     , validate_checksum_(settings.validate_checksum)
+    , buffered_reads_(settings.buffered_reads)
+    , pipelined_parse_(settings.pipelined_parse)
+#if defined(KTH_CURRENCY_BCH)
+    , streamed_blocks_(settings.streamed_blocks)
+#else
+    , streamed_blocks_(false)
+#endif
     , verbose_(settings.verbose)
     , version_(settings.protocol_maximum)
-    , message_subscriber_(pool)
+    , message_subscriber_(pool, settings.unsubscribed_messages)
     , stop_subscriber_(std::make_shared<stop_subscriber>(pool, NAME "_sub"))
-    , dispatch_(pool, NAME "_dispatch")
+    , parse_dispatch_(pool, NAME "_parse")
+    , send_queue_(size_t(settings.send_high_water_kilobytes) * 1024,
+        size_t(settings.send_low_water_kilobytes) * 1024,
+        size_t(settings.send_queue_limit_kilobytes) * 1024)
+    , parse_backlog_(maximum_pipelined_bytes)
 {}
 
 proxy::~proxy() {
@@ -66,6 +90,14 @@ void proxy::set_negotiated_version(uint32_t value) {
     version_.store(value);
 }
 
+void proxy::set_dispatch_policy(dispatch_policy::ptr policy) {
+    message_subscriber_.set_dispatch_policy(std::move(policy));
+}
+
+message_metrics const& proxy::metrics() const {
+    return metrics_;
+}
+
 // Start sequence.
 // ----------------------------------------------------------------------------
 
@@ -100,9 +132,15 @@ void proxy::read_heading() {
     if (stopped())
         return;
 
+    if (buffered_reads_) {
+        parse_buffered();
+        return;
+    }
+
     async_read(socket_->get(), buffer(heading_buffer_),
-        std::bind(&proxy::handle_read_heading,
-            shared_from_this(), _1, _2));
+        make_recycled_handler(read_memory_, [self = shared_from_this()](boost_code const& ec, size_t size) {
+            self->handle_read_heading(ec, size);
+        }));
 }
 
 void proxy::handle_read_heading(boost_code const& ec, size_t) {
@@ -122,10 +160,19 @@ void proxy::handle_read_heading(boost_code const& ec, size_t) {
     // supports an additional parameter for offset initialization, which is required here.
     auto const head = domain::create_old<heading>(heading_buffer_, 0);
 
+    if ( ! validate_heading(head)) {
+        return;
+    }
+
+    read_payload(head);
+}
+
+// Stops the channel and returns false if the heading is not acceptable.
+bool proxy::validate_heading(heading const& head) {
     if ( ! head.is_valid()) {
         LOG_WARNING(LOG_NETWORK, "Invalid heading from [", authority(), "]");
         stop(error::bad_stream);
-        return;
+        return false;
     }
 
     if (head.magic() != protocol_magic_) {
@@ -134,7 +181,7 @@ void proxy::handle_read_heading(boost_code const& ec, size_t) {
            , "Invalid heading magic (", head.magic(), ") from ["
            , authority(), "]");
         stop(error::bad_stream);
-        return;
+        return false;
     }
 
     if (head.payload_size() > max_payload_size) {
@@ -150,10 +197,10 @@ void proxy::handle_read_heading(boost_code const& ec, size_t) {
            , " heading from [", authority(), "] ("
            , head.payload_size(), " bytes)");
         stop(error::bad_stream);
-        return;
+        return false;
     }
 
-    read_payload(head);
+    return true;
 }
 
 void proxy::read_payload(heading const& head) {
@@ -161,13 +208,49 @@ void proxy::read_payload(heading const& head) {
         return;
     }
 
-    // This does not cause a reallocation.
-    payload_buffer_.resize(head.payload_size());
+    payload_buffer_.reserve(head.payload_size());
+    start_stream(head);
+    read_remainder(head, 0);
+}
+
+// Reads the payload from the offset. When a block is streamed each part is
+// decoded as it arrives, overlapping the read.
+void proxy::read_remainder(heading const& head, size_t offset) {
+    auto& payload = *payload_buffer_.get();
+    auto const remainder = buffer(payload.data() + offset, payload.size() - offset);
+    auto handler = make_recycled_handler(read_memory_, [self = shared_from_this(), head, offset](boost_code const& ec, size_t bytes) {
+        self->handle_read_payload(ec, bytes, head, offset);
+    });
+
+    if (block_stream_.active()) {
+        socket_->get().async_read_some(remainder, std::move(handler));
+        return;
+    }
+
+    async_read(socket_->get(), remainder, std::move(handler));
+}
+
+// Begins decoding a block payload as it arrives, if so configured.
+void proxy::start_stream(heading const& head) {
+    if (streamed_blocks_ && head.type() == message_type::block) {
+        block_stream_.start(head.payload_size());
+    }
+}
 
-    async_read(socket_->get(), buffer(payload_buffer_), std::bind(&proxy::handle_read_payload, shared_from_this(), _1, _2, head));
+// Decodes what has arrived of a streamed block.
+// Stops the channel and returns false if the block is not valid.
+bool proxy::stream_payload(heading const& head, size_t size) {
+    if ( ! block_stream_.active() || block_stream_.update(*payload_buffer_.get(), size)) {
+        return true;
+    }
+
+    block_stream_.reset();
+    LOG_VERBOSE(LOG_NETWORK, "Invalid ", head.command(), " payload from [", authority(), "] streamed parse failed.");
+    stop(error::bad_stream);
+    return false;
 }
 
-void proxy::handle_read_payload(boost_code const& ec, size_t payload_size, heading const& head) {
+void proxy::handle_read_payload(boost_code const& ec, size_t bytes, heading const& head, size_t offset) {
     if (stopped()) return;
 
     if (ec) {
@@ -178,43 +261,104 @@ void proxy::handle_read_payload(boost_code const& ec, size_t payload_size, headi
         return;
     }
 
-    // This is a pointless test but we allow it as an option for completeness.
-    if (validate_checksum_ && head.checksum() != bitcoin_checksum(payload_buffer_)) {
+    offset += bytes;
+
+    if ( ! stream_payload(head, offset)) {
+        return;
+    }
+
+    if (offset < head.payload_size()) {
+        read_remainder(head, offset);
+        return;
+    }
+
+    if ( ! handle_payload(head, offset)) {
+        return;
+    }
+
+    read_heading();
+}
+
+// Validates the payload buffer, then parses it and notifies subscribers.
+// Stops the channel and returns false if the payload is not acceptable.
+// With pipelined parsing also returns false if reading must pause.
+bool proxy::handle_payload(heading const& head, size_t payload_size) {
+    auto const payload = payload_buffer_.get();
+
+    if (validate_checksum_ && head.checksum() != bitcoin_checksum(*payload)) {
+        metrics_.checksum_failure(head.type());
         LOG_WARNING(LOG_NETWORK, "Invalid ", head.command(), " payload from [", authority(), "] bad checksum.");
         stop(error::bad_stream);
-        return;
+        return false;
+    }
+
+    // A streamed block has been decoded as it was read (see stream_payload).
+    block_stream::result_ptr streamed;
+
+    if (block_stream_.active()) {
+        streamed = block_stream_.finish();
+
+        if ( ! streamed) {
+            LOG_VERBOSE(LOG_NETWORK, "Invalid ", head.command(), " payload from [", authority(), "] incomplete stream.");
+            stop(error::bad_stream);
+            return false;
+        }
+    }
+
+    // A small payload read while no parse is pending is parsed in place, as
+    // without pipelining, so that its buffer is kept and the pool untouched.
+    if (pipelined_parse_ && (payload_size > payload_buffer::minimum_capacity || ! parse_backlog_.empty())) {
+        payload_buffer_.release();
+        return pipeline_payload(head, payload, streamed);
+    }
+
+    if ( ! parse_payload(head, payload, streamed)) {
+        return false;
     }
 
+    payload_buffer_.parsed(payload_size);
+    return true;
+}
+
+// Stops the channel and returns false if the payload is not acceptable.
+bool proxy::parse_payload(heading const& head, payload_pool::buffer_ptr const& payload, block_stream::result_ptr const& streamed) {
+    auto const payload_size = payload->size();
+
     LOG_DEBUG(LOG_NETWORK
        , "Read ", head.command(), " from [", authority()
        , "] (", payload_size, " bytes). Now parsing ...");
 
     // Notify subscribers of the new message.
-    byte_reader reader(payload_buffer_);
+    byte_reader reader(*payload);
 
     // Failures are not forwarded to subscribers and channel is stopped below.
-    auto const code = message_subscriber_.load(head.type(), version_, reader);
-    auto const consumed = reader.is_exhausted();
+    auto const start = std::chrono::steady_clock::now();
+    auto const code = streamed ?
+        message_subscriber_.notify(head.type(), std::move(streamed->block)) :
+        message_subscriber_.load(head.type(), version_, reader);
+    auto const parse = std::chrono::steady_clock::now() - start + (streamed ? streamed->parse_time : std::chrono::nanoseconds(0));
+    auto const consumed = streamed || reader.is_exhausted();
+    metrics_.received(head.type(), heading_buffer_.size() + payload_size, parse);
 
     if (verbose_ && code) {
         auto const size = std::min(payload_size, invalid_payload_dump_size);
-        auto const begin = payload_buffer_.begin();
+        auto const begin = payload->begin();
 
         LOG_VERBOSE(LOG_NETWORK, "Invalid payload from [", authority(), "] ", encode_base16(data_chunk{ begin, begin + size }));
         stop(code);
-        return;
+        return false;
     }
 
     if (code) {
         LOG_VERBOSE(LOG_NETWORK, "Invalid ", head.command(), " payload from [", authority(), "] ", code.message());
         stop(code);
-        return;
+        return false;
     }
 
     if ( ! consumed) {
         LOG_VERBOSE(LOG_NETWORK, "Invalid ", head.command(), " payload from [", authority(), "] trailing bytes.");
         stop(error::bad_stream);
-        return;
+        return false;
     }
 
     LOG_DEBUG(LOG_NETWORK
@@ -222,42 +366,208 @@ void proxy::handle_read_payload(boost_code const& ec, size_t payload_size, headi
        , "] (", payload_size, " bytes)");
 
     signal_activity();
-    read_heading();
+    return true;
 }
 
-// Message send sequence.
+// Pipelined parse (optional).
 // ----------------------------------------------------------------------------
+// The payload buffer is handed to an ordered parse job and the next read is
+// started with a fresh buffer from the pool, so reading continues while a
+// large message (such as a block) is parsed and handled. Parse jobs of a
+// channel run in the order the payloads were read. Small payloads are only
+// handed off behind a pending parse (see handle_payload).
+
+// Returns false if reading must pause until pending parses complete.
+bool proxy::pipeline_payload(heading const& head, payload_pool::buffer_ptr payload, block_stream::result_ptr streamed) {
+    auto const resume = parse_backlog_.push(head.payload_size());
+    parse_dispatch_.ordered(&proxy::handle_parse, shared_from_this(), head, payload, streamed);
+    return resume;
+}
 
-void proxy::do_send(command_ptr command, payload_ptr payload, result_handler handler) {
-    async_write(socket_->get(), buffer(*payload),
-        std::bind(&proxy::handle_send,
-            shared_from_this(), _1, _2, command, payload, handler));
+void proxy::handle_parse(heading const& head, payload_pool::buffer_ptr payload, block_stream::result_ptr streamed) {
+    if ( ! stopped()) {
+        parse_payload(head, payload, streamed);
+    }
+
+    // The read cycle is idle while paused, so it is resumed from here.
+    if (parse_backlog_.pop(head.payload_size())) {
+        read_heading();
+    }
 }
 
-void proxy::handle_send(boost_code const& ec, size_t, command_ptr command, payload_ptr payload, result_handler handler) {
-    dispatch_.unlock();
-    auto const size = payload->size();
-    auto const error = code(error::boost_to_error_code(ec));
+// Buffered read cycle (optional).
+// ----------------------------------------------------------------------------
+// Reads whatever the socket has available into the read buffer and parses as
+// many complete messages as it holds before reading again. A payload that
+// does not fit in the read buffer is completed by a direct read.
+
+void proxy::read_buffered() {
+    if (stopped()) {
+        return;
+    }
 
+    // Move unparsed bytes to the front, so that the free space is contiguous.
+    if (read_begin_ != 0) {
+        std::copy(read_buffer_.begin() + read_begin_, read_buffer_.begin() + read_end_, read_buffer_.begin());
+        read_end_ -= read_begin_;
+        read_begin_ = 0;
+    }
+
+    auto const free = buffer(read_buffer_.data() + read_end_, read_buffer_.size() - read_end_);
+    socket_->get().async_read_some(free,
+        make_recycled_handler(read_memory_, [self = shared_from_this()](boost_code const& ec, size_t bytes) {
+            self->handle_read_buffered(ec, bytes);
+        }));
+}
+
+void proxy::handle_read_buffered(boost_code const& ec, size_t bytes) {
     if (stopped()) {
-        handler(error);
         return;
     }
 
-    if (error) {
+    if (ec) {
+        LOG_DEBUG(LOG_NETWORK
+           , "Buffered read failure [", authority(), "] "
+           , code(error::boost_to_error_code(ec)).message());
+        stop(ec);
+        return;
+    }
+
+    read_end_ += bytes;
+    parse_buffered();
+}
+
+void proxy::parse_buffered() {
+    auto const heading_size = heading_buffer_.size();
+
+    while ( ! stopped() && read_end_ - read_begin_ >= heading_size) {
+        auto const begin = read_buffer_.begin() + read_begin_;
+        std::copy_n(begin, heading_size, heading_buffer_.begin());
+        auto const head = domain::create_old<heading>(heading_buffer_, 0);
+
+        if ( ! validate_heading(head)) {
+            return;
+        }
+
+        size_t const payload_size = head.payload_size();
+        auto const available = read_end_ - read_begin_ - heading_size;
+        auto const buffered = std::min(available, payload_size);
+
+        auto& payload = payload_buffer_.reserve(payload_size);
+        std::copy_n(begin + heading_size, buffered, payload.begin());
+        read_begin_ += heading_size + buffered;
+
+        start_stream(head);
+
+        if ( ! stream_payload(head, buffered)) {
+            return;
+        }
+
+        // The payload is completed by a direct read into the payload buffer,
+        // after which read_heading resumes parsing the read buffer.
+        if (buffered < payload_size) {
+            read_remainder(head, buffered);
+            return;
+        }
+
+        if ( ! handle_payload(head, payload_size)) {
+            return;
+        }
+    }
+
+    read_buffered();
+}
+
+// Message send sequence.
+// ----------------------------------------------------------------------------
+
+// The payload may be shared with other channels, so only the heading is
+// built here. Sends queue behind the write in flight and are written as one
+// batch of heading and payload buffers when it completes.
+void proxy::send(wire_ptr wire, result_handler handler) {
+    auto const size = static_cast<uint32_t>(wire->data.size());
+    heading const head(protocol_magic_, wire->command, size, wire->checksum);
+    auto const data = std::make_shared<data_chunk>(head.to_data());
+    auto const bytes = data->size() + size;
+    auto start = false;
+
+    // A peer that does not read cannot make us buffer without bound.
+    if ( ! send_queue_.push({ head.type(), data, wire, handler }, bytes, start)) {
+        LOG_DEBUG(LOG_NETWORK
+           , "Send queue limit exceeded by ", wire->command, " to ["
+           , authority(), "] (", bytes, " bytes)");
+        stop(error::peer_throttling);
+        handler(error::peer_throttling);
+        return;
+    }
+
+    if (start) {
+        do_send();
+    }
+}
+
+bool proxy::congested() const {
+    return send_queue_.congested();
+}
+
+void proxy::do_send() {
+    auto const batch = std::make_shared<send_batch>(send_queue_.take());
+
+    // Asio copies the buffer sequence, so a span avoids copying the vector.
+    // The vector is reused, it is not touched again until the write completes.
+    write_buffers_.clear();
+
+    for (auto const& item: *batch) {
+        write_buffers_.push_back(buffer(*item.heading));
+        write_buffers_.push_back(buffer(item.wire->data));
+    }
+
+    async_write(socket_->get(), std::span<const_buffer const>(write_buffers_),
+        make_recycled_handler(write_memory_, [self = shared_from_this(), batch](boost_code const& ec, size_t bytes) {
+            self->handle_send(ec, bytes, batch);
+        }));
+}
+
+void proxy::handle_send(boost_code const& ec, size_t bytes, send_batch_ptr batch) {
+    auto const error = code(error::boost_to_error_code(ec));
+
+    // Sends queued behind a failed write fail with it.
+    auto const failed = error ? send_queue_.clear() : send_batch{};
+    auto const more = send_queue_.complete();
+
+    size_t size = 0;
+    for (auto const& item: *batch) {
+        size += item.heading->size() + item.wire->data.size();
+    }
+
+    if (error && ! stopped()) {
         LOG_DEBUG(LOG_NETWORK
-           , "Failure sending ", *command, " to [", authority()
+           , "Failure sending ", batch->size(), " messages to [", authority()
            , "] (", size, " bytes) ", error.message());
         stop(error);
-        handler(error);
-        return;
     }
 
-    LOG_VERBOSE(LOG_NETWORK
-       , "Sent ", *command, " to [", authority(), "] (", size
-       , " bytes)");
+    if ( ! error && ! stopped()) {
+        LOG_VERBOSE(LOG_NETWORK
+           , "Sent ", batch->size(), " messages to [", authority(), "] ("
+           , bytes, " bytes)");
+    }
+
+    for (auto const& item: *batch) {
+        if ( ! error) {
+            metrics_.sent(item.type, item.heading->size() + item.wire->data.size());
+        }
+
+        item.handler(error);
+    }
+
+    for (auto const& item: failed) {
+        item.handler(error);
+    }
 
-    handler(error);
+    if (more) {
+        do_send();
+    }
 }
 
 // Stop sequence.
@@ -26,11 +26,12 @@ namespace kth::network {
 
 using namespace std::placeholders;
 
-session::session(p2p& network, bool notify_on_connect)
+session::session(p2p& network, bool notify_on_connect, session_kind kind)
     : pool_(network.thread_pool())
     , settings_(network.network_settings())
     , stopped_(true)
     , notify_on_connect_(notify_on_connect)
+    , kind_(kind)
     , network_(network)
     , dispatch_(pool_, NAME) {}
 
@@ -54,13 +55,16 @@ code session::fetch_address(address& out_address) const {
     return network_.fetch_address(out_address);
 }
 
-bool session::blacklisted(authority const& authority) const {
-    auto const ip_compare = [&](const infrastructure::config::authority& blocked) {
-        return authority.ip() == blocked.ip();
-    };
+code session::attempt(address const& host) {
+    return network_.attempt(host);
+}
+
+code session::good(address const& host) {
+    return network_.good(host);
+}
 
-    auto const& list = settings_.blacklist;
-    return std::any_of(list.begin(), list.end(), ip_compare);
+bool session::blacklisted(authority const& authority) const {
+    return network_.blacklisted(authority);
 }
 
 bool session::stopped() const {
@@ -71,6 +75,10 @@ bool session::stopped(code const& ec) const {
     return stopped() || ec == error::service_stopped;
 }
 
+void session::connect_failed() {
+    network_.connections(kind_).failed();
+}
+
 // Socket creators.
 // ----------------------------------------------------------------------------
 
@@ -149,18 +157,20 @@ void session::register_channel(channel::ptr channel, result_handler handle_start
         return;
     }
 
+    // The nonce identifies the channel while pending (see p2p::pending).
+    channel->set_nonce(pseudo_random_broken_do_not_use::next(1, max_uint64));
     start_channel(channel, BIND4(handle_start, _1, channel, handle_started, handle_stopped));
 }
 
 void session::start_channel(channel::ptr channel, result_handler handle_started) {
     channel->set_notify(notify_on_connect_);
-    channel->set_nonce(pseudo_random_broken_do_not_use::next(1, max_uint64));
+    channel->set_dispatch_policy(network_.message_dispatch_policy());
 
     // The channel starts, invokes the handler, then starts the read cycle.
-    channel->start(BIND3(handle_starting, _1, channel, handle_started));
+    channel->start(BIND4(handle_starting, _1, channel, clock::now(), handle_started));
 }
 
-void session::handle_starting(code const& ec, channel::ptr channel, result_handler handle_started) {
+void session::handle_starting(code const& ec, channel::ptr channel, clock::time_point started, result_handler handle_started) {
     if (ec) {
         LOG_DEBUG(LOG_NETWORK
            , "Channel failed to start [", channel->authority(), "] "
@@ -169,7 +179,7 @@ void session::handle_starting(code const& ec, channel::ptr channel, result_handl
         return;
     }
 
-    attach_handshake_protocols(channel, BIND3(handle_handshake, _1, channel, handle_started));
+    attach_handshake_protocols(channel, BIND4(handle_handshake, _1, channel, started, handle_started));
 }
 
 void session::attach_handshake_protocols(channel::ptr channel, result_handler handle_started) {
@@ -182,7 +192,7 @@ void session::attach_handshake_protocols(channel::ptr channel, result_handler ha
     }
 }
 
-void session::handle_handshake(code const& ec, channel::ptr channel, result_handler handle_started) {
+void session::handle_handshake(code const& ec, channel::ptr channel, clock::time_point started, result_handler handle_started) {
     if (ec) {
         LOG_DEBUG(LOG_NETWORK, "Failure in handshake with [", channel->authority(), "] ", ec.message());
 
@@ -190,6 +200,9 @@ void session::handle_handshake(code const& ec, channel::ptr channel, result_hand
         return;
     }
 
+    auto const latency = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - started);
+    network_.connections(kind_).handshake(latency);
+
     handshake_complete(channel, handle_started);
 }
 
@@ -203,9 +216,14 @@ void session::handle_start(code const& ec, channel::ptr channel, result_handler
     // All closures must eventually be invoked as otherwise it is a leak.
     // Therefore upon start failure expect start failure and stop callbacks.
     if (ec) {
+        if ( ! stopped(ec)) {
+            connect_failed();
+        }
+
         channel->stop(ec);
         handle_stopped(ec);
     } else {
+        network_.connections(kind_).succeeded();
         channel->subscribe_stop(BIND3(handle_remove, _1, channel, handle_stopped));
     }
 
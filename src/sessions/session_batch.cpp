@@ -20,8 +20,8 @@ using namespace kth::config;
 using namespace kd::message;
 using namespace std::placeholders;
 
-session_batch::session_batch(p2p& network, bool notify_on_connect)
-    : session(network, notify_on_connect)
+session_batch::session_batch(p2p& network, bool notify_on_connect, session_kind kind)
+    : session(network, notify_on_connect, kind)
     , batch_size_(std::max(settings_.connect_batch_size, 1u)) {}
 
 // Connect sequence.
@@ -48,7 +48,7 @@ void session_batch::new_connect(channel_handler handler) {
     start_connect(ec, address, handler);
 }
 
-void session_batch::start_connect(code const& ec, authority const& host, channel_handler handler) {
+void session_batch::start_connect(code const& ec, address const& host, channel_handler handler) {
     if (stopped(ec)) {
         LOG_DEBUG(LOG_NETWORK, "Batch session stopped while starting.");
         handler(error::service_stopped, nullptr);
@@ -62,26 +62,37 @@ void session_batch::start_connect(code const& ec, authority const& host, channel
         return;
     }
 
+    authority const peer(host);
+
     // This creates a tight loop in the case of a small address pool.
-    if (blacklisted(host)) {
-        LOG_DEBUG(LOG_NETWORK, "Fetched blacklisted address [", host, "] ");
+    if (blacklisted(peer)) {
+        LOG_DEBUG(LOG_NETWORK, "Fetched blacklisted address [", peer, "] ");
         handler(error::address_blocked, nullptr);
         return;
     }
 
-    LOG_DEBUG(LOG_NETWORK, "Connecting to [", host, "]");
+    LOG_DEBUG(LOG_NETWORK, "Connecting to [", peer, "]");
+
+    // Counted as a failure until the handshake completes (see good), so
+    // that a peer which accepts and then stalls is not favored.
+    attempt(host);
 
     auto const connector = create_connector();
     pend(connector);
 
     // CONNECT
-    connector->connect(host, BIND4(handle_connect, _1, _2, connector, handler));
+    connector->connect(peer, BIND4(handle_connect, _1, _2, connector, handler));
 }
 
 void session_batch::handle_connect(code const& ec, channel::ptr channel, connector::ptr connector, channel_handler handler) {
     unpend(connector);
 
     if (ec) {
+        // A cancelled connect is not a failure of the session.
+        if ( ! stopped(ec)) {
+            connect_failed();
+        }
+
         handler(ec, nullptr);
         return;
     }
@@ -20,8 +20,10 @@ namespace kth::network {
 using namespace std::placeholders;
 
 session_inbound::session_inbound(p2p& network, bool notify_on_connect)
-    : session(network, notify_on_connect)
+    : session(network, notify_on_connect, session_kind::inbound)
     , connection_limit_(settings_.inbound_connections + settings_.outbound_connections + settings_.peers.size())
+    , admission_(settings_.inbound_connections_per_ip, settings_.inbound_connections_per_group,
+        settings_.inbound_handshakes, settings_.inbound_accepts_per_second, settings_.inbound_accept_burst)
     , CONSTRUCT_TRACK(session_inbound) {}
 
 // Start sequence.
@@ -82,11 +84,62 @@ void session_inbound::start_accept(code const&) {
     }
 
     // ACCEPT THE NEXT INCOMING CONNECTION
-    acceptor_->accept(BIND2(handle_accept, _1, _2));
+    acceptor_->accept(BIND1(admit, _1), BIND2(handle_accept, _1, _2));
+}
+
+// Invoked by the acceptor for the raw socket, before a channel is constructed.
+// One address or network must not be able to take every inbound slot, so an
+// admitted connection takes a slot, returned when its channel stops.
+// A burst of new connections must not starve established channels of the
+// threadpool, so accepts are rate limited and handshakes in progress capped
+// (see inbound_admission). All of these limits are opt-in.
+code session_inbound::admit(authority const& authority) {
+    if (blacklisted(authority)) {
+        LOG_DEBUG(LOG_NETWORK
+           , "Rejected inbound connection from ["
+           , authority, "] due to blacklisted address.");
+        return error::address_blocked;
+    }
+
+    // Inbound connections can easily overflow in the case where manual and/or
+    // outbound connections at the time are not yet connected as configured.
+    if (connection_count() >= connection_limit_) {
+        LOG_DEBUG(LOG_NETWORK
+           , "Rejected inbound connection from ["
+           , authority, "] due to connection limit.");
+        return error::accept_failed;
+    }
+
+    switch (admission_.admit(authority.to_network_address().ip())) {
+        case inbound_admission::result::address_limit:
+            LOG_DEBUG(LOG_NETWORK
+               , "Rejected inbound connection from ["
+               , authority, "] due to address or netgroup limit.");
+            return error::accept_failed;
+        case inbound_admission::result::handshake_limit:
+            LOG_DEBUG(LOG_NETWORK
+               , "Rejected inbound connection from ["
+               , authority, "] due to handshakes in progress.");
+            return error::accept_failed;
+        case inbound_admission::result::rate_limit:
+            LOG_DEBUG(LOG_NETWORK
+               , "Rejected inbound connection from ["
+               , authority, "] due to accept rate limit.");
+            return error::accept_failed;
+        case inbound_admission::result::admitted:
+        default:
+            return error::success;
+    }
 }
 
 void session_inbound::handle_accept(code const& ec, channel::ptr channel) {
     if (stopped(ec)) {
+        // The slot and handshake were taken on admission.
+        if (channel) {
+            admission_.end_handshake();
+            admission_.release(channel->authority().to_network_address().ip());
+        }
+
         LOG_DEBUG(LOG_NETWORK, "Suspended inbound connection.");
         return;
     }
@@ -99,28 +152,17 @@ void session_inbound::handle_accept(code const& ec, channel::ptr channel) {
         return;
     }
 
-    if (blacklisted(channel->authority())) {
-        LOG_DEBUG(LOG_NETWORK
-           , "Rejected inbound connection from ["
-           , channel->authority(), "] due to blacklisted address.");
-        return;
-    }
-
-    // Inbound connections can easily overflow in the case where manual and/or
-    // outbound connections at the time are not yet connected as configured.
-    if (connection_count() >= connection_limit_) {
-        LOG_DEBUG(LOG_NETWORK
-           , "Rejected inbound connection from ["
-           , channel->authority(), "] due to connection limit.");
-        return;
-    }
+    auto const ip = channel->authority().to_network_address().ip();
 
     register_channel(channel,
         BIND2(handle_channel_start, _1, channel),
-        BIND1(handle_channel_stop, _1));
+        BIND2(handle_channel_stop, _1, ip));
 }
 
 void session_inbound::handle_channel_start(code const& ec, channel::ptr channel) {
+    // Invoked once for each registered channel, whether or not it started.
+    admission_.end_handshake();
+
     if (ec) {
         LOG_DEBUG(LOG_NETWORK, "Inbound channel failed to start [", channel->authority(), "] ", ec.message());
         return;
@@ -148,7 +190,8 @@ void session_inbound::attach_protocols(channel::ptr channel) {
     attach<protocol_address_31402>(channel)->start();
 }
 
-void session_inbound::handle_channel_stop(code const& ec) {
+void session_inbound::handle_channel_stop(code const& ec, connection_slots::ip_address const& ip) {
+    admission_.release(ip);
     LOG_DEBUG(LOG_NETWORK, "Inbound channel stopped: ", ec.message());
 }
 
@@ -22,7 +22,7 @@ namespace kth::network {
 using namespace std::placeholders;
 
 session_manual::session_manual(p2p& network, bool notify_on_connect)
-    : session(network, notify_on_connect)
+    : session(network, notify_on_connect, session_kind::manual)
     , CONSTRUCT_TRACK(session_manual) {}
 
 // Start sequence.
@@ -78,6 +78,10 @@ void session_manual::handle_connect(code const& ec, channel::ptr channel, std::s
     unpend(connector);
 
     if (ec) {
+        if ( ! stopped(ec)) {
+            connect_failed();
+        }
+
         LOG_WARNING(LOG_NETWORK
            , "Failure connecting [", infrastructure::config::endpoint(hostname, port)
            , "] manually: ", ec.message());
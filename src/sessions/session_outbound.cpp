@@ -22,7 +22,7 @@ namespace kth::network {
 using namespace std::placeholders;
 
 session_outbound::session_outbound(p2p& network, bool notify_on_connect)
-    : session_batch(network, notify_on_connect)
+    : session_batch(network, notify_on_connect, session_kind::outbound)
     , CONSTRUCT_TRACK(session_outbound)
 {}
 
@@ -90,6 +90,11 @@ void session_outbound::handle_channel_start(code const& ec, channel::ptr channel
     }
 
     LOG_DEBUG(LOG_NETWORK, "Connected outbound channel [", channel->authority(), "] (", connection_count(), ")");
+
+    // Promote the address once the handshake has completed, so that later
+    // selection favors it.
+    good(channel->authority().to_network_address());
+
     attach_protocols(channel);
 }
 
@@ -26,7 +26,7 @@ static size_t const minimum_host_increase = 1;
 
 using namespace std::placeholders;
 session_seed::session_seed(p2p& network)
-    : session(network, false)
+    : session(network, false, session_kind::seed)
     , CONSTRUCT_TRACK(session_seed) {}
 
 // Start sequence.
@@ -124,6 +124,10 @@ void session_seed::handle_connect(code const& ec, channel::ptr channel, infrastr
     unpend(connector);
 
     if (ec) {
+        if ( ! stopped(ec)) {
+            connect_failed();
+        }
+
         LOG_INFO(LOG_NETWORK, "Failure contacting seed [", seed, "] ", ec.message());
         handler(ec);
         return;
@@ -25,7 +25,16 @@ settings::settings()
 #endif
     , relay_transactions(true)
     , validate_checksum(false)
+    , buffered_reads(false)
+    , pipelined_parse(false)
+    , streamed_blocks(false)
+    , unsubscribed_messages(unsubscribed_policy::parse)
     , inbound_connections(0)
+    , inbound_connections_per_ip(0)
+    , inbound_connections_per_group(0)
+    , inbound_accepts_per_second(0)
+    , inbound_accept_burst(0)
+    , inbound_handshakes(0)
     , outbound_connections(8)
     , manual_attempt_limit(0)
     , connect_batch_size(5)
@@ -36,7 +45,12 @@ settings::settings()
     , channel_expiration_minutes(60)
     , channel_germination_seconds(30)
     , host_pool_capacity(1000)
+    , host_pool_checkpoint_minutes(10)
+    , send_high_water_kilobytes(1024)
+    , send_low_water_kilobytes(256)
+    , send_queue_limit_kilobytes(65536)
     , hosts_file("hosts.cache")
+    , blacklist_file("")
     , self(unspecified_network_address)
     // , bitcoin_cash(false)
 
@@ -198,4 +212,8 @@ duration settings::channel_germination() const {
     return seconds(channel_germination_seconds);
 }
 
+duration settings::host_pool_checkpoint() const {
+    return minutes(host_pool_checkpoint_minutes);
+}
+
 } // namespace kth::network
@@ -0,0 +1,249 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/statistics_server.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <kth/domain.hpp>
+
+namespace kth::network {
+
+using namespace std::placeholders;
+
+static auto const reuse_address = asio::acceptor::reuse_address(true);
+
+// Requests are only a request line and headers, this bounds their size.
+static size_t const maximum_request_size = 8 * 1024;
+
+static std::string const metrics_path = "/metrics";
+
+static
+std::string make_response(std::string const& status, std::string const& body) {
+    return "HTTP/1.1 " + status + "\r\n"
+        "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "Connection: close\r\n"
+        "\r\n" + body;
+}
+
+statistics_server::statistics_server(threadpool& pool, render_handler render,
+    asio::duration timeout, size_t connection_limit)
+    : pool_(pool)
+    , render_(std::move(render))
+    , timeout_(timeout)
+    , connection_limit_(connection_limit)
+    , connections_(0)
+    , stopped_(true)
+    , port_(0)
+    , acceptor_(pool_.service())
+{}
+
+// Start/stop sequences.
+// ----------------------------------------------------------------------------
+
+code statistics_server::start(infrastructure::config::authority const& authority) {
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock_upgrade();
+
+    if ( ! stopped()) {
+        mutex_.unlock_upgrade();
+        //---------------------------------------------------------------------
+        return error::operation_failed;
+    }
+
+    boost_code error;
+    asio::endpoint const endpoint(authority.asio_ip(), authority.port());
+
+    mutex_.unlock_upgrade_and_lock();
+    //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+    acceptor_.open(endpoint.protocol(), error);
+
+    if ( ! error) {
+        acceptor_.set_option(reuse_address, error);
+    }
+
+    if ( ! error) {
+        acceptor_.bind(endpoint, error);
+    }
+
+    if ( ! error) {
+        acceptor_.listen(asio::max_connections, error);
+    }
+
+    if ( ! error) {
+        port_ = acceptor_.local_endpoint().port();
+        stopped_ = false;
+    } else {
+        boost_code ignore;
+        acceptor_.close(ignore);
+    }
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    if ( ! error) {
+        accept();
+    }
+
+    return error::boost_to_error_code(error);
+}
+
+uint16_t statistics_server::port() const {
+    return port_;
+}
+
+void statistics_server::stop() {
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock_upgrade();
+
+    if ( ! stopped()) {
+        mutex_.unlock_upgrade_and_lock();
+        //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+        // This will asynchronously invoke the handler of the pending accept.
+        boost_code ignore;
+        acceptor_.cancel(ignore);
+        acceptor_.close(ignore);
+
+        port_ = 0;
+        stopped_ = true;
+        //---------------------------------------------------------------------
+        mutex_.unlock();
+        return;
+    }
+
+    mutex_.unlock_upgrade();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// private
+bool statistics_server::stopped() const {
+    return stopped_;
+}
+
+// Request sequence.
+// ----------------------------------------------------------------------------
+
+// private
+void statistics_server::accept() {
+    auto const socket = std::make_shared<kth::socket>(pool_);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock_upgrade();
+
+    if (stopped()) {
+        mutex_.unlock_upgrade();
+        //---------------------------------------------------------------------
+        return;
+    }
+
+    mutex_.unlock_upgrade_and_lock();
+    //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+    acceptor_.async_accept(socket->get(),
+        std::bind(&statistics_server::handle_accept, shared_from_this(), _1, socket));
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// private
+void statistics_server::handle_accept(boost_code const& ec, socket::ptr socket) {
+    if (stopped()) {
+        return;
+    }
+
+    if (ec) {
+        LOG_DEBUG(LOG_NETWORK, "Statistics accept failure: ", ec.message());
+        accept();
+        return;
+    }
+
+    // Counted before the next accept, so that the limit cannot be overrun.
+    auto const admitted = ++connections_ <= connection_limit_;
+
+    // Accept the next request regardless of the outcome of this one.
+    accept();
+
+    if ( ! admitted) {
+        --connections_;
+        LOG_DEBUG(LOG_NETWORK, "Statistics connection limit reached.");
+        socket->stop();
+        return;
+    }
+
+    // A client that does not complete its request cannot hold the connection.
+    auto const timer = std::make_shared<deadline>(pool_, timeout_);
+    timer->start(std::bind(&statistics_server::handle_timeout, shared_from_this(), _1, socket));
+
+    auto const request = std::make_shared<std::string>();
+    ::asio::async_read_until(socket->get(), ::asio::dynamic_buffer(*request, maximum_request_size), "\r\n\r\n",
+        std::bind(&statistics_server::handle_read, shared_from_this(), _1, _2, socket, timer, request));
+}
+
+// private
+// Stopping the socket fails the pending read or write, which finishes.
+void statistics_server::handle_timeout(code const& ec, socket::ptr socket) {
+    if (ec) {
+        return;
+    }
+
+    LOG_DEBUG(LOG_NETWORK, "Statistics request timed out.");
+    socket->stop();
+}
+
+// private
+void statistics_server::handle_read(boost_code const& ec, size_t, socket::ptr socket, deadline::ptr timer, request_ptr request) {
+    if (ec) {
+        finish(socket, timer);
+        return;
+    }
+
+    auto const response = respond(*request);
+    ::asio::async_write(socket->get(), ::asio::buffer(*response),
+        std::bind(&statistics_server::handle_write, shared_from_this(), _1, _2, socket, timer, response));
+}
+
+// private
+void statistics_server::handle_write(boost_code const&, size_t, socket::ptr socket, deadline::ptr timer, response_ptr) {
+    finish(socket, timer);
+}
+
+// private
+// Called once per admitted connection, when its read or write completes.
+void statistics_server::finish(socket::ptr socket, deadline::ptr timer) {
+    timer->stop();
+    socket->stop();
+    --connections_;
+}
+
+// private
+// Only the request line is read, as in "GET /metrics HTTP/1.1".
+statistics_server::response_ptr statistics_server::respond(std::string const& request) const {
+    auto const line = request.substr(0, request.find("\r\n"));
+    auto const method_end = line.find(' ');
+    auto const method = line.substr(0, method_end);
+    auto const target = method_end == std::string::npos ? std::string{} :
+        line.substr(method_end + 1, line.find(' ', method_end + 1) - method_end - 1);
+    auto const path = target.substr(0, target.find('?'));
+
+    if (method != "GET") {
+        return std::make_shared<std::string>(make_response("405 Method Not Allowed", ""));
+    }
+
+    if (path != metrics_path) {
+        return std::make_shared<std::string>(make_response("404 Not Found", ""));
+    }
+
+    return std::make_shared<std::string>(make_response("200 OK", render_()));
+}
+
+} // namespace kth::network
@@ -0,0 +1,50 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kth/network/token_bucket.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+namespace kth::network {
+
+// A burst smaller than one token would never allow a consume.
+token_bucket::token_bucket(size_t rate, size_t burst)
+    : rate_(double(rate))
+    , burst_(double(std::max(burst, size_t(1))))
+    , tokens_(burst_)
+    , updated_(clock::now())
+{}
+
+bool token_bucket::consume() {
+    return consume(clock::now());
+}
+
+bool token_bucket::consume(clock::time_point now) {
+    if (rate_ == 0) {
+        return true;
+    }
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (now > updated_) {
+        std::chrono::duration<double> const elapsed = now - updated_;
+        tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+        updated_ = now;
+    }
+
+    if (tokens_ < 1) {
+        return false;
+    }
+
+    tokens_ -= 1;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace kth::network
@@ -0,0 +1,78 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <system_error>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+using tcp = ::asio::ip::tcp;
+
+static auto const timeout = std::chrono::seconds(30);
+static uint16_t const test_port = 28335;
+
+// Start Test Suite: acceptor tests
+
+TEST_CASE("acceptor  accept  admission rejected  socket closed without channel", "[acceptor tests]") {
+    network::settings configuration;
+    configuration.inbound_port = test_port;
+    configuration.use_ipv6 = false;
+
+    threadpool pool("acceptor_test", 2);
+    auto const instance = std::make_shared<acceptor>(pool, configuration);
+    REQUIRE(instance->listen(test_port) == error::success);
+
+    // The first connection is rejected, the second admitted.
+    std::atomic<size_t> admissions{ 0 };
+    auto const admit = [&admissions](infrastructure::config::authority const&) {
+        return ++admissions == 1 ? error::accept_failed : error::success;
+    };
+
+    std::promise<channel::ptr> accepted;
+    instance->accept(admit, [&accepted](code const& ec, channel::ptr channel) {
+        accepted.set_value(ec ? nullptr : channel);
+    });
+
+    ::asio::io_context context;
+    tcp::endpoint const endpoint(::asio::ip::make_address("127.0.0.1"), test_port);
+
+    tcp::socket rejected(context);
+    rejected.connect(endpoint);
+
+    // The peer observes the close of the rejected socket.
+    uint8_t byte;
+    std::error_code read_error;
+    auto const read = rejected.read_some(::asio::buffer(&byte, 1), read_error);
+
+    auto channel = accepted.get_future();
+    auto const pending = channel.wait_for(std::chrono::milliseconds(200));
+
+    tcp::socket admitted(context);
+    admitted.connect(endpoint);
+    auto const status = channel.wait_for(timeout);
+    auto const created = status == std::future_status::ready ? channel.get() : nullptr;
+
+    instance->stop(error::service_stopped);
+    pool.shutdown();
+    pool.join();
+    REQUIRE(read == 0);
+    REQUIRE(read_error);
+    REQUIRE(pending == std::future_status::timeout);
+    REQUIRE(status == std::future_status::ready);
+    REQUIRE(created);
+    REQUIRE(created->authority().port() == admitted.local_endpoint().port());
+    REQUIRE(admissions == 2);
+}
+
+// End Test Suite
@@ -0,0 +1,88 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+static
+address_blacklist::ip_address address(std::string const& text) {
+    address_blacklist::range value;
+    REQUIRE(address_blacklist::parse(text, value));
+    return value.first;
+}
+
+static
+address_blacklist::ranges ranges(std::initializer_list<std::string> texts) {
+    address_blacklist::ranges out;
+
+    for (auto const& text: texts) {
+        address_blacklist::range value;
+        REQUIRE(address_blacklist::parse(text, value));
+        out.push_back(value);
+    }
+
+    return out;
+}
+
+// Start Test Suite: address blacklist tests
+
+TEST_CASE("address blacklist  parse  malformed  false", "[address blacklist tests]") {
+    address_blacklist::range value;
+    REQUIRE( ! address_blacklist::parse("nonsense", value));
+    REQUIRE( ! address_blacklist::parse("10.0.0.0/", value));
+    REQUIRE( ! address_blacklist::parse("10.0.0.0/33", value));
+    REQUIRE( ! address_blacklist::parse("2001:db8::/129", value));
+}
+
+TEST_CASE("address blacklist  blocked  ipv4 block  bounds", "[address blacklist tests]") {
+    address_blacklist blacklist;
+    blacklist.assign(ranges({ "1.2.3.0/25" }));
+    REQUIRE(blacklist.blocked(address("1.2.3.0")));
+    REQUIRE(blacklist.blocked(address("1.2.3.127")));
+    REQUIRE( ! blacklist.blocked(address("1.2.3.128")));
+    REQUIRE( ! blacklist.blocked(address("1.2.2.255")));
+}
+
+TEST_CASE("address blacklist  blocked  ipv6 block  bounds", "[address blacklist tests]") {
+    address_blacklist blacklist;
+    blacklist.assign(ranges({ "2001:db8::/32" }));
+    REQUIRE(blacklist.blocked(address("2001:db8:ffff::1")));
+    REQUIRE( ! blacklist.blocked(address("2001:db9::")));
+}
+
+TEST_CASE("address blacklist  assign  overlapping  merged", "[address blacklist tests]") {
+    address_blacklist blacklist;
+    blacklist.assign(ranges({ "10.1.0.0/16", "192.168.1.7", "10.0.0.0/8" }));
+    REQUIRE(blacklist.size() == 2);
+    REQUIRE(blacklist.blocked(address("10.1.2.3")));
+    REQUIRE(blacklist.blocked(address("10.255.255.255")));
+    REQUIRE(blacklist.blocked(address("192.168.1.7")));
+    REQUIRE( ! blacklist.blocked(address("192.168.1.8")));
+}
+
+TEST_CASE("address blacklist  read  comments and blank lines  ignored", "[address blacklist tests]") {
+    auto const file = std::filesystem::temp_directory_path() / "kth_address_blacklist_test.txt";
+    std::ofstream(file) << "# blocked\n 10.0.0.0/8  # private\n\n2001:db8::1\n";
+
+    address_blacklist::ranges values;
+    REQUIRE(address_blacklist::read(file, values) == error::success);
+    REQUIRE(values.size() == 2);
+
+    std::ofstream(file) << "10.0.0.0/8\nbad\n";
+    values.clear();
+    REQUIRE(address_blacklist::read(file, values) == error::bad_stream);
+
+    std::filesystem::remove(file);
+    REQUIRE(address_blacklist::read(file, values) == error::file_system);
+}
+
+// End Test Suite
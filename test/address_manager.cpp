@@ -0,0 +1,228 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+using address = address_manager::address;
+
+// Each index is in its own netgroup (/16).
+static
+address make_address(size_t index, uint16_t port = 8333) {
+    auto const text = std::to_string(1 + index / 256) + "." +
+        std::to_string(index % 256) + ".0.1:" + std::to_string(port);
+    return infrastructure::config::authority(text).to_network_address();
+}
+
+static
+address const source = infrastructure::config::authority("200.1.0.1:8333").to_network_address();
+
+static
+address_manager::entry find_entry(address_manager const& instance, address const& host) {
+    for (auto const& value: instance.snapshot()) {
+        if (address_manager::address_equal{}(value.host, host)) {
+            return value;
+        }
+    }
+
+    FAIL("address not found");
+    return {};
+}
+
+// Start Test Suite: address manager tests
+
+TEST_CASE("address manager  netgroup  ipv4  /16", "[address manager tests]") {
+    auto const first = make_address(0).ip();
+    auto const same = infrastructure::config::authority("1.0.42.42:8333").to_network_address().ip();
+    auto const other = make_address(1).ip();
+    REQUIRE(address_manager::netgroup(first) == address_manager::netgroup(same));
+    REQUIRE(address_manager::netgroup(first) != address_manager::netgroup(other));
+}
+
+TEST_CASE("address manager  add  duplicate  false", "[address manager tests]") {
+    address_manager instance(100);
+    REQUIRE(instance.add(make_address(0), source));
+    REQUIRE( ! instance.add(make_address(0), source));
+    REQUIRE(instance.add(make_address(0, 8334), source));
+    REQUIRE(instance.size() == 2);
+    REQUIRE(instance.tried_size() == 0);
+}
+
+TEST_CASE("address manager  add  full bucket  evicts most failed", "[address manager tests]") {
+    // Capacity of four is a single new bucket of three and no tried table.
+    address_manager instance(4);
+    REQUIRE(instance.add(make_address(0), source));
+    REQUIRE(instance.add(make_address(1), source));
+    REQUIRE(instance.add(make_address(2), source));
+    instance.attempt(make_address(1), 1000);
+    instance.attempt(make_address(1), 1000);
+    instance.attempt(make_address(2), 1000);
+
+    REQUIRE(instance.add(make_address(3), source));
+    REQUIRE(instance.size() == 3);
+    REQUIRE(instance.exists(make_address(0)));
+    REQUIRE( ! instance.exists(make_address(1)));
+    REQUIRE(instance.exists(make_address(2)));
+    REQUIRE(instance.exists(make_address(3)));
+}
+
+TEST_CASE("address manager  add  full bucket  evicts oldest of equals", "[address manager tests]") {
+    address_manager instance(4);
+    REQUIRE(instance.add(make_address(0), source));
+    REQUIRE(instance.add(make_address(1), source));
+    REQUIRE(instance.add(make_address(2), source));
+
+    REQUIRE(instance.add(make_address(3), source));
+    REQUIRE(instance.size() == 3);
+    REQUIRE( ! instance.exists(make_address(0)));
+}
+
+TEST_CASE("address manager  add  single source  limited to source buckets", "[address manager tests]") {
+    // 64 new buckets of 16, of which one source netgroup reaches at most 8.
+    address_manager instance(64 * 16 * 4 / 3 + 1);
+
+    for (size_t index = 0; index < 1000; ++index) {
+        instance.add(make_address(index), source);
+    }
+
+    REQUIRE(instance.size() <= 8 * 16);
+    REQUIRE(instance.size() > 16);
+}
+
+TEST_CASE("address manager  add  many sources  spread over buckets", "[address manager tests]") {
+    address_manager instance(64 * 16 * 4 / 3 + 1);
+
+    for (size_t index = 0; index < 1000; ++index) {
+        instance.add(make_address(index), make_address(index, 1));
+    }
+
+    REQUIRE(instance.size() > 8 * 16);
+}
+
+TEST_CASE("address manager  good  new address  promoted to tried", "[address manager tests]") {
+    address_manager instance(64);
+    auto const host = make_address(0);
+    REQUIRE(instance.add(host, source));
+    instance.attempt(host, 1000);
+    instance.good(host, 2000);
+
+    REQUIRE(instance.size() == 1);
+    REQUIRE(instance.tried_size() == 1);
+
+    auto const value = find_entry(instance, host);
+    REQUIRE(value.tried);
+    REQUIRE(value.failures == 0);
+    REQUIRE(value.last_success == 2000);
+    REQUIRE(value.last_attempt == 2000);
+}
+
+TEST_CASE("address manager  good  unknown address  ignored", "[address manager tests]") {
+    address_manager instance(64);
+    instance.good(make_address(0), 1000);
+    REQUIRE(instance.empty());
+}
+
+TEST_CASE("address manager  good  full tried bucket  demotes most failed to new", "[address manager tests]") {
+    // Capacity of 64 is a single tried bucket of 16.
+    address_manager instance(64);
+
+    for (size_t index = 0; index < 16; ++index) {
+        REQUIRE(instance.add(make_address(index), source));
+        instance.good(make_address(index), 1000);
+    }
+
+    REQUIRE(instance.tried_size() == 16);
+    instance.attempt(make_address(3), 1000);
+
+    REQUIRE(instance.add(make_address(16), source));
+    instance.good(make_address(16), 1000);
+
+    REQUIRE(instance.size() == 17);
+    REQUIRE(instance.tried_size() == 16);
+    REQUIRE( ! find_entry(instance, make_address(3)).tried);
+    REQUIRE(find_entry(instance, make_address(16)).tried);
+}
+
+TEST_CASE("address manager  remove  tried address  removed", "[address manager tests]") {
+    address_manager instance(64);
+    REQUIRE(instance.add(make_address(0), source));
+    REQUIRE(instance.add(make_address(1), source));
+    instance.good(make_address(0), 1000);
+
+    REQUIRE(instance.remove(make_address(0)));
+    REQUIRE( ! instance.remove(make_address(0)));
+    REQUIRE(instance.size() == 1);
+    REQUIRE(instance.tried_size() == 0);
+}
+
+TEST_CASE("address manager  select  empty  false", "[address manager tests]") {
+    address_manager instance(64);
+    address out;
+    REQUIRE( ! instance.select(out, 1000));
+}
+
+TEST_CASE("address manager  select  failing address  rarely selected", "[address manager tests]") {
+    address_manager instance(64);
+    auto const healthy = make_address(0);
+    auto const failing = make_address(1);
+    REQUIRE(instance.add(healthy, source));
+    REQUIRE(instance.add(failing, source));
+
+    for (size_t failure = 0; failure < 8; ++failure) {
+        instance.attempt(failing, 1000);
+    }
+
+    size_t selected = 0;
+
+    for (size_t draw = 0; draw < 1000; ++draw) {
+        address out;
+        REQUIRE(instance.select(out, 1000));
+        selected += address_manager::address_equal{}(out, failing) ? 1 : 0;
+    }
+
+    REQUIRE(selected < 10);
+}
+
+TEST_CASE("address manager  select  tried and new  both selected", "[address manager tests]") {
+    address_manager instance(64);
+    auto const tried = make_address(0);
+    auto const fresh = make_address(1);
+    REQUIRE(instance.add(tried, source));
+    REQUIRE(instance.add(fresh, source));
+    instance.good(tried, 1000);
+
+    size_t selected = 0;
+
+    for (size_t draw = 0; draw < 1000; ++draw) {
+        address out;
+        REQUIRE(instance.select(out, 1000));
+        selected += address_manager::address_equal{}(out, tried) ? 1 : 0;
+    }
+
+    // Tried and new are drawn from evenly.
+    REQUIRE(selected > 350);
+    REQUIRE(selected < 650);
+}
+
+TEST_CASE("address manager  copy  tried first  bounded by count", "[address manager tests]") {
+    address_manager instance(64);
+    REQUIRE(instance.add(make_address(0), source));
+    REQUIRE(instance.add(make_address(1), source));
+    instance.good(make_address(1), 1000);
+
+    address::list out;
+    instance.copy(out, 1);
+    REQUIRE(out.size() == 1);
+    REQUIRE(address_manager::address_equal{}(out.front(), make_address(1)));
+}
+
+// End Test Suite
@@ -0,0 +1,203 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstddef>
+#include <cstdint>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+static auto const protocol = network::version::level::maximum;
+
+static
+domain::chain::transaction make_transaction(uint32_t index, size_t inputs, size_t outputs, size_t script_size) {
+    domain::chain::input::list ins;
+    domain::chain::output::list outs;
+
+    for (size_t input = 0; input < inputs; ++input) {
+        ins.emplace_back(domain::chain::output_point{ null_hash, index },
+            domain::chain::script{ data_chunk(script_size, 0x51), false }, max_uint32);
+    }
+
+    for (size_t output = 0; output < outputs; ++output) {
+        outs.emplace_back(uint64_t(index), domain::chain::script{ data_chunk(script_size + output, 0x6a), false });
+    }
+
+    return domain::chain::transaction{ 1, index, std::move(ins), std::move(outs) };
+}
+
+// Transactions of varied shapes, including scripts with multibyte sizes.
+static
+domain::message::block make_block(size_t transactions) {
+    domain::chain::transaction::list txs;
+
+    for (size_t index = 0; index < transactions; ++index) {
+        txs.push_back(make_transaction(uint32_t(index), 1 + index % 3, index % 3, index * 150));
+    }
+
+    domain::chain::header const header{ 1, null_hash, null_hash, 42, 0x1d00ffff, 7 };
+    return domain::message::block{ header, std::move(txs) };
+}
+
+// The header followed by the specified bytes.
+static
+data_chunk make_payload(data_chunk const& body) {
+    domain::chain::header const header{ 1, null_hash, null_hash, 42, 0x1d00ffff, 7 };
+    auto out = header.to_data();
+    out.insert(out.end(), body.begin(), body.end());
+    return out;
+}
+
+// Stream the payload in two parts, split at the offset.
+static
+block_stream::result_ptr stream(data_chunk const& payload, size_t split) {
+    block_stream instance;
+    instance.start(payload.size());
+    REQUIRE(instance.update(payload, split));
+    REQUIRE(instance.update(payload, payload.size()));
+    return instance.finish();
+}
+
+// Start Test Suite: block stream tests
+
+TEST_CASE("block stream  update  split at every offset  decoded", "[block stream tests]") {
+    auto const sent = make_block(5);
+    auto const payload = sent.to_data(protocol);
+
+    for (size_t split = 0; split <= payload.size(); ++split) {
+        auto const result = stream(payload, split);
+        REQUIRE(result);
+        REQUIRE(result->block == sent);
+    }
+}
+
+TEST_CASE("block stream  update  byte at a time  decoded", "[block stream tests]") {
+    auto const sent = make_block(5);
+    auto const payload = sent.to_data(protocol);
+
+    block_stream instance;
+    instance.start(payload.size());
+
+    for (size_t size = 1; size <= payload.size(); ++size) {
+        REQUIRE(instance.update(payload, size));
+    }
+
+    auto const result = instance.finish();
+    REQUIRE(result);
+    REQUIRE(result->block == sent);
+    REQUIRE( ! instance.active());
+}
+
+TEST_CASE("block stream  finish  equals buffered parse", "[block stream tests]") {
+    auto const payload = make_block(12).to_data(protocol);
+
+    byte_reader reader(payload);
+    auto const parsed = domain::message::block::from_data(reader, protocol);
+    REQUIRE(parsed);
+
+    auto const result = stream(payload, payload.size() / 3);
+    REQUIRE(result);
+    REQUIRE(result->block == *parsed);
+    REQUIRE(result->block.transactions().size() == 12);
+}
+
+TEST_CASE("block stream  finish  header only  empty block", "[block stream tests]") {
+    auto const sent = make_block(0);
+    auto const result = stream(sent.to_data(protocol), 40);
+    REQUIRE(result);
+    REQUIRE(result->block == sent);
+}
+
+TEST_CASE("block stream  finish  trailing bytes  null", "[block stream tests]") {
+    auto payload = make_block(3).to_data(protocol);
+    payload.push_back(0x00);
+
+    block_stream instance;
+    instance.start(payload.size());
+    REQUIRE(instance.update(payload, payload.size()));
+    REQUIRE( ! instance.finish());
+    REQUIRE( ! instance.active());
+}
+
+TEST_CASE("block stream  finish  truncated  null", "[block stream tests]") {
+    auto const payload = make_block(3).to_data(protocol);
+
+    block_stream instance;
+    instance.start(payload.size());
+    REQUIRE(instance.update(payload, payload.size() - 1));
+    REQUIRE( ! instance.finish());
+}
+
+TEST_CASE("block stream  finish  truncated count  null", "[block stream tests]") {
+    // A two byte count of which one byte has arrived.
+    auto const payload = make_payload({ 0xfd, 0x01 });
+
+    block_stream instance;
+    instance.start(payload.size());
+    REQUIRE(instance.update(payload, payload.size()));
+    REQUIRE( ! instance.finish());
+}
+
+TEST_CASE("block stream  update  oversized count  invalid", "[block stream tests]") {
+    auto const payload = make_payload({ 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff });
+
+    block_stream instance;
+    instance.start(payload.size() + 1000);
+    REQUIRE( ! instance.update(payload, payload.size()));
+}
+
+TEST_CASE("block stream  update  count beyond payload  invalid", "[block stream tests]") {
+    // At most 12 transactions fit in 120 bytes after the header.
+    auto const payload = make_payload({ 13 });
+
+    block_stream instance;
+    instance.start(80 + 120);
+    REQUIRE( ! instance.update(payload, payload.size()));
+
+    auto const fits = make_payload({ 12 });
+    instance.start(80 + 120);
+    REQUIRE(instance.update(fits, fits.size()));
+}
+
+TEST_CASE("block stream  update  input count beyond payload  invalid", "[block stream tests]") {
+    // One transaction, version, then an input count of 2^32 - 1.
+    auto const payload = make_payload({ 0x01, 0x01, 0x00, 0x00, 0x00, 0xfe, 0xff, 0xff, 0xff, 0xff });
+
+    block_stream instance;
+    instance.start(payload.size() + 1000);
+    REQUIRE( ! instance.update(payload, payload.size()));
+}
+
+TEST_CASE("block stream  update  script size beyond payload  invalid", "[block stream tests]") {
+    // One transaction of one input, whose script claims 2^32 - 1 bytes.
+    data_chunk body{ 0x01, 0x01, 0x00, 0x00, 0x00, 0x01 };
+    body.insert(body.end(), 36, 0x00);
+    body.insert(body.end(), { 0xfe, 0xff, 0xff, 0xff, 0xff });
+    auto const payload = make_payload(body);
+
+    block_stream instance;
+    instance.start(payload.size() + 1000);
+    REQUIRE( ! instance.update(payload, payload.size()));
+}
+
+TEST_CASE("block stream  finish  witness transaction  null", "[block stream tests]") {
+    // One transaction with a marker, flag and one witness item.
+    data_chunk body{ 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01 };
+    body.insert(body.end(), 36, 0x00);
+    body.insert(body.end(), { 0x00, 0xff, 0xff, 0xff, 0xff, 0x01 });
+    body.insert(body.end(), { 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 });
+    body.insert(body.end(), { 0x01, 0x01, 0x51, 0x00, 0x00, 0x00, 0x00 });
+    auto const payload = make_payload(body);
+
+    block_stream instance;
+    instance.start(payload.size());
+    auto const valid = instance.update(payload, payload.size());
+    REQUIRE(( ! valid || ! instance.finish()));
+}
+
+// End Test Suite
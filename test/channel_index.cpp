@@ -0,0 +1,148 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <test_helpers.hpp>
+#include <loopback.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+using nonce_channels = channel_index<uint64_t>;
+using authority_channels = channel_index<infrastructure::config::authority, authority_hash>;
+
+static
+uint64_t nonce_of(channel::ptr const& channel) {
+    return channel->nonce();
+}
+
+static
+infrastructure::config::authority authority_of(channel::ptr const& channel) {
+    return channel->authority();
+}
+
+// Start Test Suite: channel index tests
+
+TEST_CASE("channel index  store  by nonce  unique", "[channel index tests]") {
+    threadpool pool("channel_index_test", 1);
+    network::settings configuration;
+    loopback first(pool, configuration);
+    loopback second(pool, configuration);
+    first.channel->set_nonce(42);
+    second.channel->set_nonce(42);
+
+    nonce_channels index(&nonce_of);
+    REQUIRE(index.store(first.channel) == error::success);
+    REQUIRE(index.store(first.channel) == error::address_in_use);
+    REQUIRE(index.store(second.channel) == error::address_in_use);
+    REQUIRE(index.exists(42));
+    REQUIRE( ! index.exists(7));
+    REQUIRE(index.size() == 1);
+
+    // Only the channel that holds the key removes it.
+    REQUIRE( ! index.remove(second.channel));
+    REQUIRE(index.remove(first.channel));
+    REQUIRE( ! index.remove(first.channel));
+    REQUIRE( ! index.exists(42));
+    REQUIRE(index.size() == 0);
+
+    first.stop();
+    second.stop();
+    pool.shutdown();
+    pool.join();
+}
+
+TEST_CASE("channel index  store  by authority  unique", "[channel index tests]") {
+    threadpool pool("channel_index_test", 1);
+    network::settings configuration;
+    loopback first(pool, configuration);
+    loopback second(pool, configuration);
+
+    // Each peer connects from its own ephemeral port.
+    REQUIRE( ! (first.channel->authority() == second.channel->authority()));
+
+    authority_channels index(&authority_of);
+    REQUIRE(index.store(first.channel) == error::success);
+    REQUIRE(index.store(second.channel) == error::success);
+    REQUIRE(index.store(first.channel) == error::address_in_use);
+    REQUIRE(index.exists(first.channel->authority()));
+    REQUIRE(index.exists(second.channel->authority()));
+    REQUIRE(index.size() == 2);
+
+    REQUIRE(index.remove(first.channel));
+    REQUIRE( ! index.exists(first.channel->authority()));
+    REQUIRE(index.exists(second.channel->authority()));
+    REQUIRE(index.size() == 1);
+
+    first.stop();
+    second.stop();
+    pool.shutdown();
+    pool.join();
+}
+
+TEST_CASE("channel index  collection  all shards  copied", "[channel index tests]") {
+    static size_t const count = 40;
+    threadpool pool("channel_index_test", 1);
+    network::settings configuration;
+    std::vector<std::unique_ptr<loopback>> peers;
+    nonce_channels index(&nonce_of);
+
+    for (size_t nonce = 0; nonce < count; ++nonce) {
+        peers.push_back(std::make_unique<loopback>(pool, configuration));
+        peers.back()->channel->set_nonce(nonce);
+        REQUIRE(index.store(peers.back()->channel) == error::success);
+    }
+
+    REQUIRE(index.size() == count);
+    REQUIRE(index.collection().size() == count);
+
+    for (size_t nonce = 0; nonce < count; ++nonce) {
+        REQUIRE(index.exists(nonce));
+    }
+
+    for (auto const& peer: peers) {
+        REQUIRE(index.remove(peer->channel));
+        peer->stop();
+    }
+
+    REQUIRE(index.size() == 0);
+    REQUIRE(index.collection().empty());
+    pool.shutdown();
+    pool.join();
+}
+
+TEST_CASE("channel index  stop  stops channels and rejects store", "[channel index tests]") {
+    threadpool pool("channel_index_test", 1);
+    network::settings configuration;
+    loopback first(pool, configuration);
+    loopback second(pool, configuration);
+    first.channel->set_nonce(1);
+    second.channel->set_nonce(2);
+    REQUIRE(first.start() == error::success);
+
+    std::promise<code> stopped;
+    first.channel->subscribe_stop([&stopped](code const& ec) {
+        stopped.set_value(ec);
+    });
+
+    nonce_channels index(&nonce_of);
+    REQUIRE(index.store(first.channel) == error::success);
+
+    index.stop(error::service_stopped);
+    REQUIRE(stopped.get_future().get() == error::service_stopped);
+    REQUIRE(index.store(second.channel) == error::service_stopped);
+
+    second.stop();
+    pool.shutdown();
+    pool.join();
+}
+
+// End Test Suite
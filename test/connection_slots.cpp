@@ -0,0 +1,54 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstdint>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+// IPv4-mapped IPv6 address.
+static
+connection_slots::ip_address ipv4(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    return { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, a, b, c, d };
+}
+
+// Start Test Suite: connection slots tests
+
+TEST_CASE("connection slots  ip limit  rejects excess", "[connection slots tests]") {
+    connection_slots slots(2, 0);
+    REQUIRE(slots.acquire(ipv4(1, 2, 3, 4)));
+    REQUIRE(slots.acquire(ipv4(1, 2, 3, 4)));
+    REQUIRE( ! slots.acquire(ipv4(1, 2, 3, 4)));
+    REQUIRE(slots.acquire(ipv4(1, 2, 3, 5)));
+}
+
+TEST_CASE("connection slots  group limit  rejects same /16", "[connection slots tests]") {
+    connection_slots slots(0, 2);
+    REQUIRE(slots.acquire(ipv4(1, 2, 3, 4)));
+    REQUIRE(slots.acquire(ipv4(1, 2, 200, 1)));
+    REQUIRE( ! slots.acquire(ipv4(1, 2, 0, 9)));
+    REQUIRE(slots.acquire(ipv4(1, 3, 0, 9)));
+}
+
+TEST_CASE("connection slots  release  frees slot", "[connection slots tests]") {
+    connection_slots slots(1, 1);
+    REQUIRE(slots.acquire(ipv4(1, 2, 3, 4)));
+    REQUIRE( ! slots.acquire(ipv4(1, 2, 3, 4)));
+    slots.release(ipv4(1, 2, 3, 4));
+    REQUIRE(slots.acquire(ipv4(1, 2, 3, 4)));
+}
+
+TEST_CASE("connection slots  rejected by group  takes no ip slot", "[connection slots tests]") {
+    connection_slots slots(1, 1);
+    REQUIRE(slots.acquire(ipv4(1, 2, 3, 4)));
+    REQUIRE( ! slots.acquire(ipv4(1, 2, 3, 5)));
+    slots.release(ipv4(1, 2, 3, 4));
+    REQUIRE(slots.acquire(ipv4(1, 2, 3, 5)));
+}
+
+// End Test Suite
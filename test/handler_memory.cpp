@@ -0,0 +1,197 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+// A chain of operations, each started by the completion of the previous,
+// as in the read cycle of a channel.
+struct chain : std::enable_shared_from_this<chain> {
+    explicit
+    chain(::asio::io_context& context)
+        : timer(context)
+    {}
+
+    void next_plain() {
+        if (remaining-- == 0) {
+            return;
+        }
+
+        timer.expires_at(::asio::steady_timer::time_point::min());
+        timer.async_wait([self = shared_from_this()](std::error_code const&) {
+            self->next_plain();
+        });
+    }
+
+    void next_recycled() {
+        if (remaining-- == 0) {
+            return;
+        }
+
+        timer.expires_at(::asio::steady_timer::time_point::min());
+        timer.async_wait(make_recycled_handler(memory, [self = shared_from_this()](std::error_code const&) {
+            self->next_recycled();
+        }));
+    }
+
+    ::asio::steady_timer timer;
+    handler_memory memory;
+    size_t remaining = 0;
+};
+
+// The read cycle of a channel, a heading read and then a payload read, each
+// started by the completion of the previous, on one connection.
+struct read_cycle : std::enable_shared_from_this<read_cycle> {
+    static constexpr size_t heading_size = 24;
+    static constexpr size_t payload_size = 8;
+
+    explicit
+    read_cycle(::asio::io_context& context)
+        : socket(context)
+        , heading(heading_size)
+        , payload(payload_size)
+    {}
+
+    void read_heading() {
+        if (remaining == 0) {
+            return;
+        }
+
+        ::asio::async_read(socket, ::asio::buffer(heading), make_recycled_handler(memory, [self = shared_from_this()](std::error_code const& ec, size_t) {
+            if ( ! ec) {
+                self->read_payload();
+            }
+        }));
+    }
+
+    void read_payload() {
+        ::asio::async_read(socket, ::asio::buffer(payload), make_recycled_handler(memory, [self = shared_from_this()](std::error_code const& ec, size_t) {
+            if ( ! ec) {
+                --self->remaining;
+                self->read_heading();
+            }
+        }));
+    }
+
+    ::asio::ip::tcp::socket socket;
+    data_chunk heading;
+    data_chunk payload;
+    handler_memory memory;
+    size_t remaining = 0;
+};
+
+// Start Test Suite: handler memory tests
+
+TEST_CASE("handler memory  allocate after deallocate  reuses storage", "[handler memory tests]") {
+    handler_memory memory;
+    auto const first = memory.allocate(64);
+    memory.deallocate(first);
+    auto const second = memory.allocate(64);
+    REQUIRE(second == first);
+    memory.deallocate(second);
+}
+
+TEST_CASE("handler memory  allocate while in use  uses heap", "[handler memory tests]") {
+    handler_memory memory;
+    auto const first = memory.allocate(64);
+    auto const second = memory.allocate(64);
+    REQUIRE(second != first);
+    memory.deallocate(second);
+
+    // The storage is still held by the first allocation.
+    auto const third = memory.allocate(64);
+    REQUIRE(third != first);
+    memory.deallocate(third);
+    memory.deallocate(first);
+}
+
+TEST_CASE("handler memory  oversized  uses heap", "[handler memory tests]") {
+    handler_memory memory;
+    auto const large = memory.allocate(4096);
+    auto const small = memory.allocate(64);
+    REQUIRE(small != large);
+    REQUIRE(memory.heap_allocations() == 1);
+    memory.deallocate(large);
+    memory.deallocate(small);
+}
+
+TEST_CASE("handler memory  recycled chain  completes", "[handler memory tests]") {
+    ::asio::io_context context;
+    auto const operations = std::make_shared<chain>(context);
+    operations->remaining = 1000;
+    operations->next_recycled();
+    REQUIRE(context.run() == 1000);
+    REQUIRE(operations->remaining == size_t(-1));
+}
+
+TEST_CASE("handler memory  recycled chain  no heap allocation", "[handler memory tests]") {
+    static size_t const operations = 20000;
+    ::asio::io_context context;
+    auto const instance = std::make_shared<chain>(context);
+    instance->remaining = operations;
+    instance->next_recycled();
+    REQUIRE(context.run() == operations);
+    REQUIRE(instance->memory.heap_allocations() == 0);
+}
+
+TEST_CASE("handler memory  read cycle  loopback  no heap allocation", "[handler memory tests]") {
+    using tcp = ::asio::ip::tcp;
+    static size_t const messages = 10000;
+
+    ::asio::io_context context;
+    ::asio::io_context peer_context;
+    tcp::acceptor acceptor(context, { ::asio::ip::make_address("127.0.0.1"), 0 });
+    tcp::socket peer(peer_context);
+    peer.connect(acceptor.local_endpoint());
+
+    auto const instance = std::make_shared<read_cycle>(context);
+    acceptor.accept(instance->socket);
+
+    // The peer writes every message while the cycle reads them.
+    data_chunk const data(messages * (read_cycle::heading_size + read_cycle::payload_size), 0x2a);
+    std::thread writer([&]() {
+        ::asio::write(peer, ::asio::buffer(data));
+    });
+
+    instance->remaining = messages;
+    instance->read_heading();
+    context.run();
+    writer.join();
+
+    REQUIRE(instance->remaining == 0);
+    REQUIRE(instance->memory.heap_allocations() == 0);
+}
+
+// Hidden, run with: kth_network_test "[.benchmark]"
+TEST_CASE("handler memory  operation chain  benchmark", "[.benchmark][handler memory tests]") {
+    static size_t const operations = 10000;
+
+    BENCHMARK("plain handler") {
+        ::asio::io_context context;
+        auto const instance = std::make_shared<chain>(context);
+        instance->remaining = operations;
+        instance->next_plain();
+        return context.run();
+    };
+
+    BENCHMARK("recycled handler") {
+        ::asio::io_context context;
+        auto const instance = std::make_shared<chain>(context);
+        instance->remaining = operations;
+        instance->next_recycled();
+        return context.run();
+    };
+}
+
+// End Test Suite
@@ -0,0 +1,190 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+#define TEST_NAME \
+    Catch::getResultCapture().getCurrentTestName()
+
+static
+std::string get_hosts_path(std::string const& test) {
+    auto const path = test + ".hosts.cache";
+    std::filesystem::remove_all(path);
+    return path;
+}
+
+static
+hosts::address make_address(std::string const& authority) {
+    return infrastructure::config::authority(authority).to_network_address();
+}
+
+// The peer that relayed the addresses.
+static auto const source = make_address("9.9.9.9:8333");
+
+// Binary header: "KTHH", version, record count (little endian).
+static
+void write_header(std::string const& path, uint8_t version, uint8_t count) {
+    std::ofstream file(path, std::ios::binary);
+    uint8_t const header[] = { 'K', 'T', 'H', 'H', version, 0, 0, 0, count, 0, 0, 0 };
+    file.write(reinterpret_cast<char const*>(header), sizeof(header));
+}
+
+// Start Test Suite: hosts tests
+
+TEST_CASE("hosts  store  duplicate  stored once", "[hosts tests]") {
+    network::settings configuration;
+    configuration.host_pool_capacity = 42;
+    configuration.hosts_file = get_hosts_path(TEST_NAME);
+    hosts instance(configuration);
+    REQUIRE(instance.start() == error::success);
+
+    REQUIRE(instance.store(make_address("1.2.3.4:8333"), source) == error::success);
+    REQUIRE(instance.store(make_address("1.2.3.4:8333"), source) == error::success);
+    REQUIRE(instance.store(make_address("1.2.3.4:8334"), source) == error::success);
+    REQUIRE(instance.count() == 2);
+    REQUIRE(instance.stop() == error::success);
+}
+
+TEST_CASE("hosts  store  over capacity  evicted address can be stored again", "[hosts tests]") {
+    network::settings configuration;
+    configuration.host_pool_capacity = 2;
+    configuration.hosts_file = get_hosts_path(TEST_NAME);
+    hosts instance(configuration);
+    REQUIRE(instance.start() == error::success);
+
+    REQUIRE(instance.store(make_address("1.2.3.4:8333"), source) == error::success);
+    REQUIRE(instance.store(make_address("1.2.3.5:8333"), source) == error::success);
+    REQUIRE(instance.store(make_address("1.2.3.6:8333"), source) == error::success);
+    REQUIRE(instance.count() == 2);
+
+    // The first address was evicted, so it is not found but may be re-added.
+    REQUIRE(instance.remove(make_address("1.2.3.4:8333")) == error::not_found);
+    REQUIRE(instance.store(make_address("1.2.3.4:8333"), source) == error::success);
+    REQUIRE(instance.remove(make_address("1.2.3.4:8333")) == error::success);
+    REQUIRE(instance.count() == 1);
+    REQUIRE(instance.stop() == error::success);
+}
+
+TEST_CASE("hosts  good  attempted address  remains fetchable", "[hosts tests]") {
+    network::settings configuration;
+    configuration.host_pool_capacity = 42;
+    configuration.hosts_file = get_hosts_path(TEST_NAME);
+    hosts instance(configuration);
+    REQUIRE(instance.start() == error::success);
+
+    auto const host = make_address("1.2.3.4:8333");
+    REQUIRE(instance.store(host, source) == error::success);
+    REQUIRE(instance.attempt(host) == error::success);
+    REQUIRE(instance.good(host) == error::success);
+
+    hosts::address out;
+    REQUIRE(instance.fetch(out) == error::success);
+    REQUIRE(out.ip() == host.ip());
+    REQUIRE(out.port() == host.port());
+    REQUIRE(instance.count() == 1);
+    REQUIRE(instance.stop() == error::success);
+}
+
+TEST_CASE("hosts  stop start  binary file  restores addresses", "[hosts tests]") {
+    network::settings configuration;
+    configuration.host_pool_capacity = 42;
+    configuration.hosts_file = get_hosts_path(TEST_NAME);
+    hosts instance(configuration);
+    REQUIRE(instance.start() == error::success);
+
+    REQUIRE(instance.store(make_address("1.2.3.4:8333"), source) == error::success);
+    REQUIRE(instance.store(make_address("[2604:880:d:2f::c7b2]:18333"), source) == error::success);
+    REQUIRE(instance.good(make_address("1.2.3.4:8333")) == error::success);
+    REQUIRE(instance.stop() == error::success);
+    REQUIRE(instance.count() == 0);
+
+    REQUIRE(instance.start() == error::success);
+    REQUIRE(instance.count() == 2);
+    REQUIRE(instance.remove(make_address("1.2.3.4:8333")) == error::success);
+    REQUIRE(instance.remove(make_address("[2604:880:d:2f::c7b2]:18333")) == error::success);
+    REQUIRE(instance.stop() == error::success);
+}
+
+TEST_CASE("hosts  start  legacy text file  loads addresses", "[hosts tests]") {
+    network::settings configuration;
+    configuration.host_pool_capacity = 42;
+    configuration.hosts_file = get_hosts_path(TEST_NAME);
+
+    {
+        std::ofstream file(configuration.hosts_file);
+        file << "1.2.3.4:8333" << std::endl;
+        file << "1.2.3.5:8333" << std::endl;
+    }
+
+    hosts instance(configuration);
+    REQUIRE(instance.start() == error::success);
+    REQUIRE(instance.count() == 2);
+    REQUIRE(instance.stop() == error::success);
+}
+
+TEST_CASE("hosts  stop  binary file  written completely", "[hosts tests]") {
+    network::settings configuration;
+    configuration.host_pool_capacity = 42;
+    configuration.hosts_file = get_hosts_path(TEST_NAME);
+    hosts instance(configuration);
+    REQUIRE(instance.start() == error::success);
+
+    REQUIRE(instance.store(make_address("1.2.3.4:8333"), source) == error::success);
+    REQUIRE(instance.store(make_address("1.2.3.5:8333"), source) == error::success);
+    REQUIRE(instance.stop() == error::success);
+
+    // Header of 12 bytes and records of 51 bytes, no temporary file left.
+    REQUIRE(std::filesystem::file_size(configuration.hosts_file) == 12 + 2 * 51);
+    REQUIRE( ! std::filesystem::exists(configuration.hosts_file.string() + ".tmp"));
+}
+
+TEST_CASE("hosts  start  unknown version  discards file", "[hosts tests]") {
+    network::settings configuration;
+    configuration.host_pool_capacity = 42;
+    configuration.hosts_file = get_hosts_path(TEST_NAME);
+    write_header(configuration.hosts_file.string(), 2, 0);
+
+    hosts instance(configuration);
+    REQUIRE(instance.start() == error::success);
+    REQUIRE(instance.count() == 0);
+    REQUIRE( ! std::filesystem::exists(configuration.hosts_file));
+
+    REQUIRE(instance.store(make_address("1.2.3.4:8333"), source) == error::success);
+    REQUIRE(instance.stop() == error::success);
+    REQUIRE(instance.start() == error::success);
+    REQUIRE(instance.count() == 1);
+    REQUIRE(instance.stop() == error::success);
+}
+
+TEST_CASE("hosts  start  truncated record  discards file", "[hosts tests]") {
+    network::settings configuration;
+    configuration.host_pool_capacity = 42;
+    configuration.hosts_file = get_hosts_path(TEST_NAME);
+    write_header(configuration.hosts_file.string(), 1, 2);
+
+    {
+        // One complete record of the two counted.
+        std::ofstream file(configuration.hosts_file, std::ios::binary | std::ios::app);
+        std::string const record(51, '\x01');
+        file.write(record.data(), record.size());
+    }
+
+    hosts instance(configuration);
+    REQUIRE(instance.start() == error::success);
+    REQUIRE(instance.count() == 0);
+    REQUIRE( ! std::filesystem::exists(configuration.hosts_file));
+    REQUIRE(instance.stop() == error::success);
+}
+
+// End Test Suite
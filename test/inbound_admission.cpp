@@ -0,0 +1,90 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+using result = inbound_admission::result;
+
+// IPv4-mapped IPv6 address.
+static
+inbound_admission::ip_address ipv4(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    return { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, a, b, c, d };
+}
+
+// Start Test Suite: inbound admission tests
+
+TEST_CASE("inbound admission  zero limits  unlimited", "[inbound admission tests]") {
+    inbound_admission instance(0, 0, 0, 0, 0);
+
+    for (size_t count = 0; count < 1000; ++count) {
+        REQUIRE(instance.admit(ipv4(1, 2, 3, 4)) == result::admitted);
+    }
+
+    REQUIRE(instance.handshakes() == 1000);
+}
+
+TEST_CASE("inbound admission  address at limit  does not consume accept rate", "[inbound admission tests]") {
+    // One connection per address, two accepts and no refill.
+    inbound_admission instance(1, 0, 0, 1, 2);
+    auto const now = token_bucket::clock::now();
+    REQUIRE(instance.admit(ipv4(1, 2, 3, 4), now) == result::admitted);
+
+    for (size_t count = 0; count < 100; ++count) {
+        REQUIRE(instance.admit(ipv4(1, 2, 3, 4), now) == result::address_limit);
+    }
+
+    // The second token remains for another address.
+    REQUIRE(instance.admit(ipv4(5, 6, 7, 8), now) == result::admitted);
+    REQUIRE(instance.admit(ipv4(9, 9, 9, 9), now) == result::rate_limit);
+}
+
+TEST_CASE("inbound admission  handshakes at limit  does not consume accept rate", "[inbound admission tests]") {
+    inbound_admission instance(1, 0, 1, 1, 2);
+    auto const now = token_bucket::clock::now();
+    REQUIRE(instance.admit(ipv4(1, 2, 3, 4), now) == result::admitted);
+
+    for (size_t count = 0; count < 100; ++count) {
+        REQUIRE(instance.admit(ipv4(5, 6, 7, 8), now) == result::handshake_limit);
+    }
+
+    REQUIRE(instance.handshakes() == 1);
+
+    // The rejected address took no slot, and the second token remains.
+    instance.end_handshake();
+    REQUIRE(instance.admit(ipv4(5, 6, 7, 8), now) == result::admitted);
+}
+
+TEST_CASE("inbound admission  rate limited  returns slot and handshake", "[inbound admission tests]") {
+    // One accept per second, no burst.
+    inbound_admission instance(1, 0, 0, 1, 1);
+    auto const now = token_bucket::clock::now();
+    REQUIRE(instance.admit(ipv4(1, 2, 3, 4), now) == result::admitted);
+    REQUIRE(instance.admit(ipv4(5, 6, 7, 8), now) == result::rate_limit);
+    REQUIRE(instance.handshakes() == 1);
+
+    // The address holds no slot, so it is admitted once the rate allows.
+    REQUIRE(instance.admit(ipv4(5, 6, 7, 8), now + std::chrono::seconds(1)) == result::admitted);
+    REQUIRE(instance.handshakes() == 2);
+}
+
+TEST_CASE("inbound admission  release  frees slot", "[inbound admission tests]") {
+    inbound_admission instance(1, 0, 0, 0, 0);
+    REQUIRE(instance.admit(ipv4(1, 2, 3, 4)) == result::admitted);
+    REQUIRE(instance.admit(ipv4(1, 2, 3, 4)) == result::address_limit);
+
+    instance.end_handshake();
+    instance.release(ipv4(1, 2, 3, 4));
+    REQUIRE(instance.admit(ipv4(1, 2, 3, 4)) == result::admitted);
+}
+
+// End Test Suite
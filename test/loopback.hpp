@@ -0,0 +1,89 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef KTH_NETWORK_TEST_LOOPBACK_HPP
+#define KTH_NETWORK_TEST_LOOPBACK_HPP
+
+#include <cstddef>
+#include <future>
+#include <memory>
+
+#include <kth/network.hpp>
+
+/// A channel connected over loopback to a socket held by the test, which
+/// plays the peer by writing and reading raw bytes synchronously.
+struct loopback {
+    using tcp = ::asio::ip::tcp;
+
+    /// A nonzero buffer size shrinks the socket buffers on both ends, so that
+    /// a write of the channel stalls until the peer reads.
+    loopback(kth::threadpool& pool, kth::network::settings const& settings, size_t buffer_size = 0)
+        : magic(settings.identifier)
+        , peer(context)
+    {
+        tcp::acceptor acceptor(context, { ::asio::ip::make_address("127.0.0.1"), 0 });
+        auto const socket = std::make_shared<kth::socket>(pool);
+
+        if (buffer_size != 0) {
+            peer.open(tcp::v4());
+            peer.set_option(::asio::socket_base::receive_buffer_size(int(buffer_size)));
+        }
+
+        peer.connect(acceptor.local_endpoint());
+        acceptor.accept(socket->get());
+
+        if (buffer_size != 0) {
+            socket->get().set_option(::asio::socket_base::send_buffer_size(int(buffer_size)));
+        }
+
+        channel = std::make_shared<kth::network::channel>(pool, socket, settings);
+    }
+
+    /// Start the read cycle of the channel.
+    kth::code start() {
+        std::promise<kth::code> promise;
+        channel->start([&promise](kth::code const& ec) {
+            promise.set_value(ec);
+        });
+        return promise.get_future().get();
+    }
+
+    void stop() {
+        channel->stop(kth::error::channel_stopped);
+    }
+
+    /// The heading and payload of a message as sent on the wire.
+    kth::data_chunk frame(kth::network::proxy::wire_ptr const& wire) const {
+        kth::domain::message::heading const head(magic, wire->command,
+            uint32_t(wire->data.size()), wire->checksum);
+
+        auto out = head.to_data();
+        out.insert(out.end(), wire->data.begin(), wire->data.end());
+        return out;
+    }
+
+    template <typename Message>
+    kth::data_chunk frame(Message const& message) const {
+        return frame(kth::network::proxy::serialize(message, channel->negotiated_version()));
+    }
+
+    /// Write bytes to the channel as the peer.
+    void write(kth::data_chunk const& data) {
+        ::asio::write(peer, ::asio::buffer(data));
+    }
+
+    /// Read bytes written by the channel as the peer.
+    kth::data_chunk read(size_t size) {
+        kth::data_chunk data(size);
+        ::asio::read(peer, ::asio::buffer(data));
+        return data;
+    }
+
+    uint32_t const magic;
+    ::asio::io_context context;
+    tcp::socket peer;
+    kth::network::channel::ptr channel;
+};
+
+#endif
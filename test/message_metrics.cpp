@@ -0,0 +1,62 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chrono>
+#include <cstddef>
+#include <set>
+#include <string>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kd::message;
+using namespace kth::network;
+
+// Start Test Suite: message metrics tests
+
+TEST_CASE("message metrics  command  listed types  distinct commands", "[message metrics tests]") {
+    REQUIRE(message_metrics::command(size_t(message_type::ping)) == ping::command);
+    REQUIRE(message_metrics::command(size_t(message_type::block)) == block::command);
+    REQUIRE(message_metrics::command(size_t(message_type::unknown)) == "unknown");
+
+    std::set<std::string> commands;
+    auto const listed = [&]<typename... Entries>(message_list<Entries...>) {
+        (commands.insert(message_metrics::command(size_t(Entries::type))), ...);
+        return sizeof...(Entries);
+    }(subscribable_messages{});
+
+    REQUIRE(commands.size() == listed);
+    REQUIRE(commands.count("unknown") == 0);
+}
+
+TEST_CASE("message metrics  sent  unlisted types  counted as unknown", "[message metrics tests]") {
+    message_metrics instance;
+    instance.sent(message_type::xverack, 24);
+    instance.sent(message_type::unknown, 30);
+    instance.received(message_type::xverack, 24, std::chrono::nanoseconds(0));
+    instance.sent(message_type::ping, 32);
+
+    message_metrics::table totals{};
+    instance.accumulate(totals);
+
+    // A single series for every unlisted type.
+    size_t unknown = 0;
+    for (size_t index = 0; index < totals.size(); ++index) {
+        if (totals[index].sent != 0 && message_metrics::command(index) == "unknown") {
+            ++unknown;
+        }
+    }
+
+    REQUIRE(unknown == 1);
+
+    auto const& entry = totals[size_t(message_type::unknown)];
+    REQUIRE(entry.sent == 2);
+    REQUIRE(entry.sent_bytes == 54);
+    REQUIRE(entry.received == 1);
+    REQUIRE(totals[size_t(message_type::ping)].sent == 1);
+}
+
+// End Test Suite
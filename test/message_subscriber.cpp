@@ -0,0 +1,195 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+
+#include <test_helpers.hpp>
+#include <loopback.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kd::message;
+using namespace kth::network;
+
+static auto const timeout = std::chrono::seconds(30);
+
+// Start Test Suite: message subscriber tests
+
+TEST_CASE("message subscriber  reject  handler declined  stops channel", "[message subscriber tests]") {
+    network::settings configuration;
+    configuration.unsubscribed_messages = unsubscribed_policy::reject;
+
+    threadpool pool("message_subscriber_test", 1);
+    loopback instance(pool, configuration);
+    REQUIRE(instance.start() == error::success);
+
+    std::promise<code> stopped;
+    instance.channel->subscribe_stop([&stopped](code const& ec) {
+        stopped.set_value(ec);
+    });
+
+    // The handler takes one ping, after which the type has a subscriber but
+    // no live handler.
+    std::promise<uint64_t> received;
+    instance.channel->subscribe<ping>([&received](code const& ec, ping::const_ptr message) {
+        if ( ! ec) {
+            received.set_value(message->nonce());
+        }
+
+        return false;
+    });
+
+    instance.write(instance.frame(ping{ 1 }));
+    auto nonce = received.get_future();
+    auto const status = nonce.wait_for(timeout);
+
+    instance.write(instance.frame(ping{ 2 }));
+    auto stop_code = stopped.get_future();
+    auto const stop_status = stop_code.wait_for(timeout);
+
+    instance.stop();
+    pool.shutdown();
+    pool.join();
+    REQUIRE(status == std::future_status::ready);
+    REQUIRE(nonce.get() == 1);
+    REQUIRE(stop_status == std::future_status::ready);
+    REQUIRE(stop_code.get() == error::not_found);
+}
+
+TEST_CASE("message subscriber  reject  handshake messages  not rejected", "[message subscriber tests]") {
+    network::settings configuration;
+    configuration.unsubscribed_messages = unsubscribed_policy::reject;
+
+    threadpool pool("message_subscriber_test", 1);
+    loopback instance(pool, configuration);
+    REQUIRE(instance.start() == error::success);
+
+    std::promise<uint64_t> received;
+    instance.channel->subscribe<ping>([&received](code const& ec, ping::const_ptr message) {
+        if ( ! ec) {
+            received.set_value(message->nonce());
+        }
+
+        return false;
+    });
+
+    // Messages are read in order, so the ping arrives only if these did not
+    // stop the channel.
+    instance.write(instance.frame(send_headers{}));
+    instance.write(instance.frame(fee_filter{ 1000 }));
+    instance.write(instance.frame(send_compact{ false, 1 }));
+    instance.write(instance.frame(ping{ 42 }));
+
+    auto nonce = received.get_future();
+    auto const status = nonce.wait_for(timeout);
+
+    instance.stop();
+    pool.shutdown();
+    pool.join();
+    REQUIRE(status == std::future_status::ready);
+    REQUIRE(nonce.get() == 42);
+}
+
+TEST_CASE("message subscriber  default  unsubscribed message  parsed and discarded", "[message subscriber tests]") {
+    network::settings configuration;
+    REQUIRE(configuration.unsubscribed_messages == unsubscribed_policy::parse);
+
+    threadpool pool("message_subscriber_test", 1);
+    loopback instance(pool, configuration);
+    REQUIRE(instance.start() == error::success);
+
+    std::promise<uint64_t> received;
+    instance.channel->subscribe<pong>([&received](code const& ec, pong::const_ptr message) {
+        if ( ! ec) {
+            received.set_value(message->nonce());
+        }
+
+        return false;
+    });
+
+    instance.write(instance.frame(ping{ 1 }));
+    instance.write(instance.frame(pong{ 2 }));
+
+    auto nonce = received.get_future();
+    auto const status = nonce.wait_for(timeout);
+
+    instance.stop();
+    pool.shutdown();
+    pool.join();
+    REQUIRE(status == std::future_status::ready);
+    REQUIRE(nonce.get() == 2);
+}
+
+TEST_CASE("message subscriber  set mode  live channel  delivered in each mode", "[message subscriber tests]") {
+    network::settings configuration;
+    auto const policy = std::make_shared<dispatch_policy>();
+    policy->set_mode(message_type::ping, dispatch_mode::relay);
+
+    // Two threads, so that a relayed handler does not block reading.
+    threadpool pool("message_subscriber_test", 2);
+    loopback instance(pool, configuration);
+    instance.channel->set_dispatch_policy(policy);
+    REQUIRE(instance.start() == error::success);
+
+    // The handler of the second ping waits on the gate.
+    std::promise<void> gate;
+    auto const opened = gate.get_future().share();
+    std::array<std::promise<void>, 5> delivered;
+    instance.channel->subscribe<ping>([&delivered, opened](code const& ec, ping::const_ptr message) {
+        if (ec) {
+            return false;
+        }
+
+        auto const nonce = message->nonce();
+
+        if (nonce == 2) {
+            opened.wait();
+        }
+
+        delivered[nonce].set_value();
+        return true;
+    });
+
+    std::array<std::future<void>, 5> futures;
+
+    for (size_t nonce = 0; nonce < futures.size(); ++nonce) {
+        futures[nonce] = delivered[nonce].get_future();
+    }
+
+    auto const received = [&futures](uint64_t nonce, auto duration) {
+        return futures[nonce].wait_for(duration);
+    };
+
+    instance.write(instance.frame(ping{ 1 }));
+    auto const relayed = received(1, timeout);
+
+    // Handled on the reading thread, the third ping is not read while the
+    // handler of the second is blocked.
+    policy->set_mode(message_type::ping, dispatch_mode::handle);
+    instance.write(instance.frame(ping{ 2 }));
+    instance.write(instance.frame(ping{ 3 }));
+    auto const blocked = received(3, std::chrono::milliseconds(200));
+    gate.set_value();
+    auto const handled = received(3, timeout);
+
+    policy->set_mode(message_type::ping, dispatch_mode::relay);
+    instance.write(instance.frame(ping{ 4 }));
+    auto const restored = received(4, timeout);
+
+    instance.stop();
+    pool.shutdown();
+    pool.join();
+    REQUIRE(relayed == std::future_status::ready);
+    REQUIRE(blocked == std::future_status::timeout);
+    REQUIRE(handled == std::future_status::ready);
+    REQUIRE(restored == std::future_status::ready);
+}
+
+// End Test Suite
@@ -2,6 +2,9 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdio>
 #include <filesystem>
 #include <future>
@@ -155,6 +158,20 @@ int send_result(Message const& message, p2p& network, int channels) {
     return result;
 }
 
+// Counts the hosts checkpoints written outside of the final save.
+class checkpoint_counter : public p2p {
+public:
+    using p2p::p2p;
+
+    std::atomic<size_t> checkpoints{ 0 };
+
+protected:
+    code checkpoint_hosts() override {
+        ++checkpoints;
+        return p2p::checkpoint_hosts();
+    }
+};
+
 // Trivial tests just validate static inits (required because p2p tests disabled in travis).
 // Start Test Suite: empty tests
 
@@ -212,6 +229,35 @@ TEST_CASE("p2p  start  no connections  start stop success", "[p2p tests]") {
     REQUIRE(network.stop());
 }
 
+TEST_CASE("p2p  stop  checkpoint pending  not written or restarted", "[p2p tests]") {
+    print_headers(TEST_NAME);
+    SETTINGS_TESTNET_ONE_THREAD_NO_CONNECTIONS(configuration);
+    configuration.host_pool_checkpoint_minutes = 1;
+    configuration.hosts_file = get_log_path(TEST_NAME, "hosts");
+    checkpoint_counter network(configuration);
+    REQUIRE(start_result(network) == error::success);
+
+    auto const begin = std::chrono::steady_clock::now();
+    REQUIRE(network.close());
+
+    // A restarted timer would hold the threadpool join for a minute.
+    REQUIRE(std::chrono::steady_clock::now() - begin < std::chrono::seconds(30));
+
+    // The canceled timer is not written over the final save.
+    REQUIRE(network.checkpoints == 0);
+    REQUIRE(std::filesystem::exists(configuration.hosts_file));
+}
+
+#if ! defined(KTH_CURRENCY_BCH)
+TEST_CASE("p2p  start  streamed blocks  operation failed", "[p2p tests]") {
+    print_headers(TEST_NAME);
+    SETTINGS_TESTNET_ONE_THREAD_NO_CONNECTIONS(configuration);
+    configuration.streamed_blocks = true;
+    p2p network(configuration);
+    REQUIRE(start_result(network) == error::operation_failed);
+}
+#endif
+
 TEST_CASE("p2p  start  no sessions  start success start operation fail", "[p2p tests]") {
     print_headers(TEST_NAME);
     SETTINGS_TESTNET_ONE_THREAD_NO_CONNECTIONS(configuration);
@@ -0,0 +1,88 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstddef>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+// The backlog of a pipelined channel.
+static size_t const maximum = 8 * 1024 * 1024;
+
+// Start Test Suite: parse backlog tests
+
+TEST_CASE("parse backlog  push  within maximum  reading continues", "[parse backlog tests]") {
+    parse_backlog instance(maximum);
+    REQUIRE(instance.push(maximum / 2));
+    REQUIRE(instance.push(maximum / 2));
+    REQUIRE( ! instance.paused());
+    REQUIRE(instance.bytes() == maximum);
+}
+
+TEST_CASE("parse backlog  push  single payload above maximum  reading continues", "[parse backlog tests]") {
+    parse_backlog instance(maximum);
+    REQUIRE(instance.push(maximum + 1));
+    REQUIRE( ! instance.paused());
+    REQUIRE( ! instance.pop(maximum + 1));
+    REQUIRE(instance.bytes() == 0);
+}
+
+TEST_CASE("parse backlog  push  above maximum  reading paused", "[parse backlog tests]") {
+    parse_backlog instance(maximum);
+    REQUIRE(instance.push(maximum));
+    REQUIRE( ! instance.push(1));
+    REQUIRE(instance.paused());
+}
+
+TEST_CASE("parse backlog  pop  drained to maximum  reading resumed once", "[parse backlog tests]") {
+    parse_backlog instance(maximum);
+    REQUIRE(instance.push(4 * 1024 * 1024));
+    REQUIRE(instance.push(4 * 1024 * 1024));
+    REQUIRE( ! instance.push(1024));
+    REQUIRE(instance.bytes() == maximum + 1024);
+
+    // Resumed by the first parse that drains to the maximum.
+    REQUIRE(instance.pop(1024));
+    REQUIRE( ! instance.paused());
+    REQUIRE( ! instance.pop(4 * 1024 * 1024));
+    REQUIRE( ! instance.pop(4 * 1024 * 1024));
+    REQUIRE(instance.bytes() == 0);
+}
+
+TEST_CASE("parse backlog  pop  above maximum  remains paused", "[parse backlog tests]") {
+    parse_backlog instance(maximum);
+    REQUIRE(instance.push(maximum));
+    REQUIRE( ! instance.push(maximum));
+    REQUIRE( ! instance.push(0));
+    REQUIRE( ! instance.pop(0));
+    REQUIRE(instance.paused());
+
+    REQUIRE(instance.pop(maximum));
+    REQUIRE( ! instance.paused());
+
+    // Paused again as soon as the maximum is exceeded.
+    REQUIRE( ! instance.push(1));
+    REQUIRE(instance.paused());
+}
+
+TEST_CASE("parse backlog  empty  until all popped", "[parse backlog tests]") {
+    parse_backlog instance(maximum);
+    REQUIRE(instance.empty());
+
+    instance.push(0);
+    instance.push(10);
+    REQUIRE( ! instance.empty());
+
+    instance.pop(0);
+    REQUIRE( ! instance.empty());
+
+    instance.pop(10);
+    REQUIRE(instance.empty());
+}
+
+// End Test Suite
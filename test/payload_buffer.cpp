@@ -0,0 +1,147 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstddef>
+#include <memory>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+static size_t const kib = 1024;
+
+// Start Test Suite: payload buffer tests
+
+TEST_CASE("payload buffer  construct  no buffer borrowed", "[payload buffer tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+    payload_buffer instance(pool);
+    REQUIRE( ! instance.get());
+    REQUIRE(pool->retained() == 0);
+
+    // Nothing to return before the first payload.
+    instance.parsed(100);
+    REQUIRE( ! instance.get());
+    REQUIRE(pool->retained() == 0);
+}
+
+TEST_CASE("payload buffer  reserve  small payload  minimum capacity", "[payload buffer tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+    payload_buffer instance(pool);
+
+    auto const& payload = instance.reserve(100);
+    REQUIRE(payload.size() == 100);
+    REQUIRE(payload.capacity() == payload_buffer::minimum_capacity);
+    REQUIRE(instance.get().get() == &payload);
+
+    // A payload that fits keeps the buffer.
+    instance.reserve(payload_buffer::minimum_capacity);
+    REQUIRE(instance.get().get() == &payload);
+    REQUIRE(pool->retained() == 0);
+}
+
+TEST_CASE("payload buffer  reserve  larger payloads  grows geometrically", "[payload buffer tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+    payload_buffer instance(pool);
+    instance.reserve(100);
+
+    // At least doubles, the outgrown buffer returns to the pool.
+    REQUIRE(instance.reserve(4 * kib + 1).capacity() == 8 * kib);
+    REQUIRE(pool->retained() == 1);
+
+    REQUIRE(instance.reserve(9 * kib).capacity() == 16 * kib);
+    REQUIRE(pool->retained() == 2);
+
+    // A payload beyond double the capacity is not rounded past its class.
+    auto const& payload = instance.reserve(100 * kib);
+    REQUIRE(payload.size() == 100 * kib);
+    REQUIRE(payload.capacity() == 128 * kib);
+    REQUIRE(pool->retained() == 3);
+
+    // A smaller payload reuses the grown buffer.
+    REQUIRE(&instance.reserve(100) == &payload);
+    REQUIRE(pool->retained() == 3);
+}
+
+TEST_CASE("payload buffer  parsed  beyond maximum retained capacity  returned", "[payload buffer tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+    payload_buffer instance(pool);
+
+    instance.reserve(payload_buffer::maximum_retained_capacity);
+    instance.parsed(payload_buffer::maximum_retained_capacity);
+    REQUIRE(instance.get());
+    REQUIRE(pool->retained() == 0);
+
+    instance.reserve(payload_buffer::maximum_retained_capacity + 1);
+    REQUIRE(pool->retained() == 1);
+
+    instance.parsed(payload_buffer::maximum_retained_capacity + 1);
+    REQUIRE( ! instance.get());
+    REQUIRE(pool->retained() == 2);
+
+    // The next payload borrows again, starting from the minimum.
+    REQUIRE(instance.reserve(100).capacity() == payload_buffer::minimum_capacity);
+}
+
+TEST_CASE("payload buffer  parsed  small payloads  grown buffer returned after shrink count", "[payload buffer tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+    payload_buffer instance(pool);
+    instance.reserve(64 * kib);
+    instance.parsed(64 * kib);
+
+    for (size_t count = 1; count < payload_buffer::shrink_count; ++count) {
+        instance.reserve(100);
+        instance.parsed(100);
+        REQUIRE(instance.get());
+    }
+
+    // A payload beyond the minimum restarts the count.
+    instance.reserve(payload_buffer::minimum_capacity + 1);
+    instance.parsed(payload_buffer::minimum_capacity + 1);
+
+    for (size_t count = 1; count < payload_buffer::shrink_count; ++count) {
+        instance.reserve(100);
+        instance.parsed(100);
+        REQUIRE(instance.get());
+    }
+
+    REQUIRE(pool->retained() == 0);
+    instance.reserve(100);
+    instance.parsed(100);
+    REQUIRE( ! instance.get());
+    REQUIRE(pool->retained() == 1);
+}
+
+TEST_CASE("payload buffer  parsed  small payloads  minimum buffer kept", "[payload buffer tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+    payload_buffer instance(pool);
+
+    for (size_t count = 0; count < 2 * payload_buffer::shrink_count; ++count) {
+        instance.reserve(100);
+        instance.parsed(100);
+        REQUIRE(instance.get());
+    }
+
+    REQUIRE(instance.get()->capacity() == payload_buffer::minimum_capacity);
+    REQUIRE(pool->retained() == 0);
+}
+
+TEST_CASE("payload buffer  release  buffer returned to pool", "[payload buffer tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+    payload_buffer instance(pool);
+    instance.reserve(100);
+
+    // A pipelined parse holds the buffer until it completes.
+    auto const payload = instance.get();
+    instance.release();
+    REQUIRE( ! instance.get());
+    REQUIRE(pool->retained() == 0);
+
+    instance.reserve(100);
+    REQUIRE(instance.get() != payload);
+}
+
+// End Test Suite
@@ -0,0 +1,124 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+static size_t const kib = 1024;
+static size_t const mib = 1024 * 1024;
+
+// Borrow count buffers of size and release them all.
+static
+void cycle(payload_pool& pool, size_t size, size_t count) {
+    std::vector<payload_pool::buffer_ptr> buffers;
+
+    for (size_t index = 0; index < count; ++index) {
+        buffers.push_back(pool.acquire(size));
+    }
+}
+
+// Start Test Suite: payload pool tests
+
+TEST_CASE("payload pool  acquire  rounds capacity up to size class", "[payload pool tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+
+    auto const empty = pool->acquire(0);
+    REQUIRE(empty->empty());
+    REQUIRE(empty->capacity() == 1 * kib);
+
+    auto const exact = pool->acquire(4 * kib);
+    REQUIRE(exact->size() == 4 * kib);
+    REQUIRE(exact->capacity() == 4 * kib);
+
+    auto const above = pool->acquire(4 * kib + 1);
+    REQUIRE(above->size() == 4 * kib + 1);
+    REQUIRE(above->capacity() == 8 * kib);
+}
+
+TEST_CASE("payload pool  release  buffer reused by next acquire", "[payload pool tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+
+    auto buffer = pool->acquire(100);
+    auto const data = buffer->data();
+    buffer.reset();
+    REQUIRE(pool->retained() == 1);
+
+    // Any size of the same class takes the retained buffer.
+    auto const reused = pool->acquire(1 * kib);
+    REQUIRE(reused->data() == data);
+    REQUIRE(pool->retained() == 0);
+}
+
+TEST_CASE("payload pool  release  other class  not reused", "[payload pool tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+    pool->acquire(100);
+    REQUIRE(pool->retained() == 1);
+
+    auto const other = pool->acquire(2 * kib);
+    REQUIRE(other->capacity() == 2 * kib);
+    REQUIRE(pool->retained() == 1);
+}
+
+TEST_CASE("payload pool  release  small class  retains at most 64", "[payload pool tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+    cycle(*pool, 1 * kib, 100);
+    REQUIRE(pool->retained() == 64);
+}
+
+TEST_CASE("payload pool  release  large class  retains class budget", "[payload pool tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+
+    // Each class retains up to 2 MiB, and at least one buffer.
+    cycle(*pool, 1 * mib, 4);
+    REQUIRE(pool->retained() == 2);
+
+    cycle(*pool, 8 * mib, 2);
+    REQUIRE(pool->retained() == 3);
+}
+
+TEST_CASE("payload pool  release  beyond largest class  not retained", "[payload pool tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+    auto buffer = pool->acquire(32 * mib + 1);
+    REQUIRE(buffer->size() == 32 * mib + 1);
+
+    buffer.reset();
+    REQUIRE(pool->retained() == 0);
+}
+
+TEST_CASE("payload pool  release  regrown buffer  not retained", "[payload pool tests]") {
+    auto const pool = std::make_shared<payload_pool>();
+    auto buffer = pool->acquire(1 * kib);
+
+    // A consumer that grows the buffer takes it out of its class.
+    buffer->resize(3000);
+    REQUIRE(buffer->capacity() != 4 * kib);
+
+    buffer.reset();
+    REQUIRE(pool->retained() == 0);
+}
+
+TEST_CASE("payload pool  release  after pool destroyed  freed", "[payload pool tests]") {
+    auto pool = std::make_shared<payload_pool>();
+    auto buffer = pool->acquire(100);
+    pool.reset();
+
+    // The releaser holds the pool weakly, the buffer is simply freed.
+    REQUIRE(buffer->size() == 100);
+    buffer.reset();
+    REQUIRE( ! buffer);
+}
+
+TEST_CASE("payload pool  instance  shared", "[payload pool tests]") {
+    REQUIRE(payload_pool::instance() == payload_pool::instance());
+}
+
+// End Test Suite
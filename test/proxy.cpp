@@ -0,0 +1,436 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <test_helpers.hpp>
+#include <loopback.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kd::message;
+using namespace kth::network;
+
+static auto const timeout = std::chrono::seconds(30);
+
+static
+domain::chain::transaction make_transaction(uint32_t index, size_t inputs, size_t outputs) {
+    domain::chain::input::list ins;
+    domain::chain::output::list outs;
+
+    for (size_t input = 0; input < inputs; ++input) {
+        ins.emplace_back(domain::chain::output_point{ null_hash, index }, domain::chain::script{}, max_uint32);
+    }
+
+    for (size_t output = 0; output < outputs; ++output) {
+        outs.emplace_back(uint64_t(index), domain::chain::script{});
+    }
+
+    return domain::chain::transaction{ 1, 0, std::move(ins), std::move(outs) };
+}
+
+static
+block make_block(size_t transactions) {
+    domain::chain::transaction::list txs;
+
+    for (size_t index = 0; index < transactions; ++index) {
+        txs.push_back(make_transaction(uint32_t(index), 1 + index % 3, 1 + index % 2));
+    }
+
+    domain::chain::header const header{ 1, null_hash, null_hash, 42, 0x1d00ffff, 7 };
+    return block{ header, std::move(txs) };
+}
+
+// A block of about size bytes, in a transaction of outputs with large scripts.
+static
+block make_large_block(size_t size, uint32_t nonce) {
+    static size_t const script_size = 10000;
+    domain::chain::output::list outs;
+
+    for (size_t output = 0; output < size / script_size; ++output) {
+        outs.emplace_back(uint64_t(output), domain::chain::script{ data_chunk(script_size, 0x6a), false });
+    }
+
+    domain::chain::transaction::list txs;
+    txs.push_back(domain::chain::transaction{ 1, 0, make_transaction(0, 1, 0).inputs(), std::move(outs) });
+
+    domain::chain::header const header{ 1, null_hash, null_hash, 42, 0x1d00ffff, nonce };
+    return block{ header, std::move(txs) };
+}
+
+// Send a block and return it as received by a subscriber.
+static
+block::const_ptr exchange_block(network::settings const& configuration, block const& sent) {
+    threadpool pool("proxy_test", 1);
+    loopback instance(pool, configuration);
+    REQUIRE(instance.start() == error::success);
+
+    std::promise<block::const_ptr> received;
+    instance.channel->subscribe<block>([&received](code const& ec, block::const_ptr message) {
+        if ( ! ec) {
+            received.set_value(message);
+        }
+
+        return false;
+    });
+
+    instance.write(instance.frame(sent));
+    auto future = received.get_future();
+    auto const status = future.wait_for(timeout);
+
+    instance.stop();
+    pool.shutdown();
+    pool.join();
+    REQUIRE(status == std::future_status::ready);
+    return future.get();
+}
+
+// A run of numbered pings, with an inventory after every hundredth that
+// grows from a few KiB to beyond the largest retained payload buffer.
+struct traffic {
+    static constexpr size_t pings = 3000;
+    static constexpr size_t interval = 100;
+
+    static
+    size_t inventory_size(size_t index) {
+        return (index / interval + 1) * 300;
+    }
+
+    static
+    inventory make_inventory(size_t size) {
+        inventory_vector::list const values(size, inventory_vector{ inventory_vector::type_id::transaction, null_hash });
+        return inventory(values);
+    }
+
+    data_chunk frame(loopback const& instance) const {
+        data_chunk out;
+
+        for (size_t index = 0; index < pings; ++index) {
+            auto const ping_frame = instance.frame(ping{ index });
+            out.insert(out.end(), ping_frame.begin(), ping_frame.end());
+
+            if (index % interval == interval - 1) {
+                auto const inventory_frame = instance.frame(make_inventory(inventory_size(index)));
+                out.insert(out.end(), inventory_frame.begin(), inventory_frame.end());
+            }
+        }
+
+        return out;
+    }
+};
+
+// Write the traffic, in one burst or in parts of chunk bytes, and check that
+// it is received in order.
+static
+void exchange_traffic(network::settings const& configuration, size_t chunk = 0) {
+    threadpool pool("proxy_test", 1);
+    loopback instance(pool, configuration);
+    REQUIRE(instance.start() == error::success);
+
+    std::mutex mutex;
+    std::vector<uint64_t> nonces;
+    std::vector<size_t> inventories;
+    std::promise<void> received;
+
+    auto const complete = [&]() {
+        if (nonces.size() == traffic::pings && inventories.size() == traffic::pings / traffic::interval) {
+            received.set_value();
+        }
+    };
+
+    instance.channel->subscribe<ping>([&](code const& ec, ping::const_ptr message) {
+        if (ec) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        nonces.push_back(message->nonce());
+        complete();
+        return true;
+    });
+
+    instance.channel->subscribe<inventory>([&](code const& ec, inventory::const_ptr message) {
+        if (ec) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        inventories.push_back(message->inventories().size());
+        complete();
+        return true;
+    });
+
+    auto const data = traffic{}.frame(instance);
+    auto const part = chunk == 0 ? data.size() : chunk;
+
+    for (size_t offset = 0; offset < data.size(); offset += part) {
+        auto const end = std::min(offset + part, data.size());
+        instance.write(data_chunk{ data.begin() + offset, data.begin() + end });
+    }
+
+    auto const status = received.get_future().wait_for(timeout);
+
+    instance.stop();
+    pool.shutdown();
+    pool.join();
+    REQUIRE(status == std::future_status::ready);
+
+    for (size_t index = 0; index < nonces.size(); ++index) {
+        REQUIRE(nonces[index] == index);
+    }
+
+    for (size_t index = 0; index < inventories.size(); ++index) {
+        REQUIRE(inventories[index] == traffic::inventory_size(index * traffic::interval));
+    }
+}
+
+// Send an inventory of about 100 KB and then pings, record the order in
+// which their handlers complete and the codes.
+struct sends {
+    static constexpr size_t inventory_entries = 2800;
+
+    explicit
+    sends(size_t count)
+        : count(count)
+    {}
+
+    void send_all(channel& channel) {
+        channel.send(traffic::make_inventory(inventory_entries), handler(0));
+
+        for (size_t index = 1; index < count; ++index) {
+            channel.send(ping{ index }, handler(index));
+        }
+    }
+
+    proxy::result_handler handler(size_t index) {
+        return [this, index](code const& ec) {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(index);
+            codes.push_back(ec);
+
+            if (order.size() == count) {
+                complete.set_value();
+            }
+        };
+    }
+
+    size_t const count;
+    std::mutex mutex;
+    std::vector<size_t> order;
+    std::vector<code> codes;
+    std::promise<void> complete;
+};
+
+// Start Test Suite: proxy tests
+
+TEST_CASE("proxy  read block  loopback  delivered", "[proxy tests]") {
+    network::settings configuration;
+    auto const sent = make_block(3);
+    auto const received = exchange_block(configuration, sent);
+    REQUIRE(*received == sent);
+}
+
+TEST_CASE("proxy  read  growing payloads  delivered in order", "[proxy tests]") {
+    network::settings configuration;
+    exchange_traffic(configuration);
+}
+
+TEST_CASE("proxy  read  growing payloads  checksum validated", "[proxy tests]") {
+    network::settings configuration;
+    configuration.validate_checksum = true;
+    exchange_traffic(configuration);
+}
+
+TEST_CASE("proxy  read buffered  burst  delivered in order", "[proxy tests]") {
+    network::settings configuration;
+    configuration.buffered_reads = true;
+    exchange_traffic(configuration);
+}
+
+TEST_CASE("proxy  read buffered  odd sized writes  delivered in order", "[proxy tests]") {
+    network::settings configuration;
+    configuration.buffered_reads = true;
+
+    // Headings and payloads are split across reads at shifting offsets.
+    exchange_traffic(configuration, 1021);
+}
+
+TEST_CASE("proxy  read buffered  checksum validated", "[proxy tests]") {
+    network::settings configuration;
+    configuration.buffered_reads = true;
+    configuration.validate_checksum = true;
+    exchange_traffic(configuration, 1021);
+}
+
+TEST_CASE("proxy  read pipelined  growing payloads  delivered in order", "[proxy tests]") {
+    network::settings configuration;
+    configuration.pipelined_parse = true;
+    exchange_traffic(configuration);
+}
+
+TEST_CASE("proxy  read pipelined  odd sized writes  delivered in order", "[proxy tests]") {
+    network::settings configuration;
+    configuration.pipelined_parse = true;
+    configuration.validate_checksum = true;
+    exchange_traffic(configuration, 1021);
+}
+
+TEST_CASE("proxy  read pipelined  parse stalled  reading paused until drained", "[proxy tests]") {
+    static size_t const count = 8;
+    static size_t const block_size = 3 * 1024 * 1024;
+    network::settings configuration;
+    configuration.pipelined_parse = true;
+
+    // Blocks are handled on the parse job, which must not share the only
+    // thread with the read cycle.
+    threadpool pool("proxy_test", 2);
+    loopback instance(pool, configuration);
+    REQUIRE(instance.start() == error::success);
+
+    std::promise<void> release;
+    auto const released = release.get_future().share();
+    std::mutex mutex;
+    std::vector<uint32_t> nonces;
+    std::promise<void> received;
+
+    instance.channel->subscribe<block>([&](code const& ec, block::const_ptr message) {
+        if (ec) {
+            return false;
+        }
+
+        released.wait();
+        std::lock_guard<std::mutex> lock(mutex);
+        nonces.push_back(message->header().nonce());
+
+        if (nonces.size() == count) {
+            received.set_value();
+        }
+
+        return true;
+    });
+
+    data_chunk data;
+    for (size_t index = 0; index < count; ++index) {
+        auto const block_frame = instance.frame(make_large_block(block_size, uint32_t(index)));
+        data.insert(data.end(), block_frame.begin(), block_frame.end());
+    }
+
+    // While the first block is stalled, reading pauses after the third (more
+    // than 8 MiB pending), so the peer cannot write the rest. The 24 MiB are
+    // well beyond what the socket buffers hold.
+    auto writer = std::async(std::launch::async, [&instance, &data]() {
+        instance.write(data);
+    });
+
+    auto const paused = writer.wait_for(std::chrono::seconds(1));
+    release.set_value();
+
+    auto const written = writer.wait_for(timeout);
+    auto const status = received.get_future().wait_for(timeout);
+
+    instance.stop();
+    pool.shutdown();
+    pool.join();
+    REQUIRE(paused == std::future_status::timeout);
+    REQUIRE(written == std::future_status::ready);
+    REQUIRE(status == std::future_status::ready);
+
+    for (size_t index = 0; index < count; ++index) {
+        REQUIRE(nonces[index] == index);
+    }
+}
+
+TEST_CASE("proxy  send  behind stalled write  written and completed in order", "[proxy tests]") {
+    static size_t const count = 500;
+    network::settings configuration;
+    configuration.send_high_water_kilobytes = 64;
+    configuration.send_low_water_kilobytes = 16;
+
+    threadpool pool("proxy_test", 1);
+    loopback instance(pool, configuration, 4096);
+    REQUIRE(instance.start() == error::success);
+
+    // The peer does not read, so the inventory write stalls and the pings
+    // queue behind it, to be written together once it completes.
+    sends sent(count);
+    sent.send_all(*instance.channel);
+    REQUIRE(instance.channel->congested());
+
+    auto expected = instance.frame(traffic::make_inventory(sends::inventory_entries));
+    for (size_t index = 1; index < count; ++index) {
+        auto const ping_frame = instance.frame(ping{ index });
+        expected.insert(expected.end(), ping_frame.begin(), ping_frame.end());
+    }
+
+    auto const received = instance.read(expected.size());
+    auto const status = sent.complete.get_future().wait_for(timeout);
+    auto const congested = instance.channel->congested();
+
+    instance.stop();
+    pool.shutdown();
+    pool.join();
+    REQUIRE(status == std::future_status::ready);
+    REQUIRE(received == expected);
+    REQUIRE( ! congested);
+
+    for (size_t index = 0; index < count; ++index) {
+        REQUIRE(sent.order[index] == index);
+        REQUIRE(sent.codes[index] == error::success);
+    }
+}
+
+TEST_CASE("proxy  send  queue limit exceeded  stops channel and fails each send once", "[proxy tests]") {
+    static size_t const count = 10;
+    network::settings configuration;
+    configuration.send_queue_limit_kilobytes = 256;
+
+    threadpool pool("proxy_test", 1);
+    loopback instance(pool, configuration, 4096);
+    REQUIRE(instance.start() == error::success);
+
+    std::promise<code> stopped;
+    instance.channel->subscribe_stop([&stopped](code const& ec) {
+        stopped.set_value(ec);
+    });
+
+    // Each inventory is about 100 KB and the peer does not read, so the
+    // third exceeds the limit with the first in flight and the second queued.
+    sends sent(count);
+    for (size_t index = 0; index < count; ++index) {
+        instance.channel->send(traffic::make_inventory(sends::inventory_entries), sent.handler(index));
+    }
+
+    auto const status = sent.complete.get_future().wait_for(timeout);
+    auto stop_code = stopped.get_future();
+    auto const stop_status = stop_code.wait_for(timeout);
+
+    instance.stop();
+    pool.shutdown();
+    pool.join();
+    REQUIRE(status == std::future_status::ready);
+    REQUIRE(stop_status == std::future_status::ready);
+    REQUIRE(stop_code.get() == error::peer_throttling);
+
+    // Every handler is invoked exactly once, and none succeeds.
+    auto order = sent.order;
+    std::sort(order.begin(), order.end());
+    for (size_t index = 0; index < count; ++index) {
+        REQUIRE(order[index] == index);
+        REQUIRE(sent.codes[index] != error::success);
+    }
+
+    auto const third = std::find(sent.order.begin(), sent.order.end(), 2);
+    REQUIRE(sent.codes[std::distance(sent.order.begin(), third)] == error::peer_throttling);
+}
+
+// End Test Suite
@@ -0,0 +1,143 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstddef>
+#include <vector>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+using queue = send_queue<size_t>;
+
+// Start Test Suite: send queue tests
+
+TEST_CASE("send queue  push  idle  starts write", "[send queue tests]") {
+    queue instance(100, 50, 0);
+    auto start = false;
+    REQUIRE(instance.push(1, 10, start));
+    REQUIRE(start);
+
+    // The caller has started the write, later sends wait behind it.
+    REQUIRE(instance.push(2, 10, start));
+    REQUIRE( ! start);
+    REQUIRE(instance.bytes() == 20);
+}
+
+TEST_CASE("send queue  take  coalesces queued items in order", "[send queue tests]") {
+    queue instance(100, 50, 0);
+    auto start = false;
+    REQUIRE(instance.push(1, 10, start));
+    REQUIRE(instance.take() == queue::batch{ 1 });
+
+    // Sends behind the write in flight are written together when it completes.
+    REQUIRE(instance.push(2, 10, start));
+    REQUIRE(instance.push(3, 10, start));
+    REQUIRE(instance.push(4, 10, start));
+    REQUIRE( ! start);
+    REQUIRE(instance.complete());
+    REQUIRE(instance.take() == queue::batch{ 2, 3, 4 });
+    REQUIRE(instance.bytes() == 30);
+
+    REQUIRE( ! instance.complete());
+    REQUIRE(instance.bytes() == 0);
+
+    // Idle again, the next send starts a write.
+    REQUIRE(instance.push(5, 10, start));
+    REQUIRE(start);
+}
+
+TEST_CASE("send queue  push  above high watermark  congested", "[send queue tests]") {
+    queue instance(100, 50, 0);
+    auto start = false;
+    REQUIRE(instance.push(1, 60, start));
+    REQUIRE( ! instance.congested());
+    REQUIRE(instance.push(2, 40, start));
+    REQUIRE( ! instance.congested());
+    REQUIRE(instance.push(3, 1, start));
+    REQUIRE(instance.congested());
+}
+
+TEST_CASE("send queue  complete  above low watermark  remains congested", "[send queue tests]") {
+    queue instance(100, 50, 0);
+    auto start = false;
+    REQUIRE(instance.push(1, 101, start));
+    instance.take();
+    REQUIRE(instance.push(2, 51, start));
+    REQUIRE(instance.congested());
+
+    // The write in flight completes, leaving more than the low watermark.
+    REQUIRE(instance.complete());
+    REQUIRE(instance.bytes() == 51);
+    REQUIRE(instance.congested());
+
+    // Below the high watermark, still congested until drained.
+    instance.take();
+    REQUIRE(instance.push(3, 40, start));
+    REQUIRE(instance.congested());
+    REQUIRE(instance.complete());
+    REQUIRE(instance.bytes() == 40);
+    REQUIRE( ! instance.congested());
+}
+
+TEST_CASE("send queue  complete  at low watermark  not congested", "[send queue tests]") {
+    queue instance(100, 50, 0);
+    auto start = false;
+    REQUIRE(instance.push(1, 101, start));
+    instance.take();
+    REQUIRE(instance.push(2, 50, start));
+    REQUIRE(instance.complete());
+    REQUIRE( ! instance.congested());
+
+    // Congestion is set again only above the high watermark.
+    REQUIRE(instance.push(3, 50, start));
+    REQUIRE( ! instance.congested());
+}
+
+TEST_CASE("send queue  push  above limit  rejected", "[send queue tests]") {
+    queue instance(100, 50, 200);
+    auto start = false;
+    REQUIRE(instance.push(1, 150, start));
+    instance.take();
+
+    // The write in flight counts against the limit.
+    REQUIRE(instance.push(2, 50, start));
+    REQUIRE( ! instance.push(3, 1, start));
+    REQUIRE( ! start);
+    REQUIRE(instance.bytes() == 200);
+
+    REQUIRE(instance.complete());
+    REQUIRE(instance.push(3, 1, start));
+}
+
+TEST_CASE("send queue  push  zero limit  unlimited", "[send queue tests]") {
+    queue instance(100, 50, 0);
+    auto start = false;
+    REQUIRE(instance.push(1, 1000000, start));
+    REQUIRE(instance.push(2, 1000000, start));
+    REQUIRE(instance.congested());
+}
+
+TEST_CASE("send queue  clear  removes queued items not in flight", "[send queue tests]") {
+    queue instance(100, 50, 0);
+    auto start = false;
+    REQUIRE(instance.push(1, 60, start));
+    instance.take();
+    REQUIRE(instance.push(2, 60, start));
+    REQUIRE(instance.push(3, 60, start));
+    REQUIRE(instance.congested());
+
+    REQUIRE(instance.clear() == queue::batch{ 2, 3 });
+    REQUIRE(instance.bytes() == 60);
+    REQUIRE(instance.congested());
+
+    REQUIRE( ! instance.complete());
+    REQUIRE(instance.bytes() == 0);
+    REQUIRE( ! instance.congested());
+}
+
+// End Test Suite
@@ -0,0 +1,132 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+// Issue a request on loopback and read the response until the server closes.
+static
+std::string get(uint16_t port, std::string const& path) {
+    ::asio::io_context context;
+    ::asio::ip::tcp::socket socket(context);
+    socket.connect({ ::asio::ip::make_address("127.0.0.1"), port });
+
+    auto const request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ::asio::write(socket, ::asio::buffer(request));
+
+    std::string response;
+    std::error_code ec;
+    ::asio::read(socket, ::asio::dynamic_buffer(response), ec);
+    return response;
+}
+
+// Read until the server closes the connection, without sending a request.
+static
+std::string read_all(::asio::ip::tcp::socket& socket) {
+    std::string response;
+    std::error_code ec;
+    ::asio::read(socket, ::asio::dynamic_buffer(response), ec);
+    return response;
+}
+
+static
+statistics_server::ptr make_server(threadpool& pool, asio::duration timeout = asio::seconds(10), size_t connection_limit = 8) {
+    auto const server = std::make_shared<statistics_server>(pool, [] {
+        return std::string("kth_test_value 42\n");
+    }, timeout, connection_limit);
+
+    // Port zero binds any available port.
+    REQUIRE(server->start(infrastructure::config::authority("127.0.0.1:0")) == error::success);
+    REQUIRE(server->port() != 0);
+    return server;
+}
+
+// Start Test Suite: statistics server tests
+
+TEST_CASE("statistics server  get metrics  renders statistics", "[statistics server tests]") {
+    threadpool pool("statistics_test", 1);
+    auto const server = make_server(pool);
+
+    auto const response = get(server->port(), "/metrics");
+    REQUIRE(response.find("HTTP/1.1 200 OK\r\n") == 0);
+    REQUIRE(response.find("Content-Length: 18\r\n") != std::string::npos);
+    REQUIRE(response.find("\r\n\r\nkth_test_value 42\n") != std::string::npos);
+
+    server->stop();
+    REQUIRE(server->port() == 0);
+    pool.shutdown();
+    pool.join();
+}
+
+TEST_CASE("statistics server  get other path  not found", "[statistics server tests]") {
+    threadpool pool("statistics_test", 1);
+    auto const server = make_server(pool);
+
+    auto const response = get(server->port(), "/other");
+    REQUIRE(response.find("HTTP/1.1 404 Not Found\r\n") == 0);
+
+    server->stop();
+    pool.shutdown();
+    pool.join();
+}
+
+TEST_CASE("statistics server  start twice  operation failed", "[statistics server tests]") {
+    threadpool pool("statistics_test", 1);
+    auto const server = make_server(pool);
+
+    REQUIRE(server->start(infrastructure::config::authority("127.0.0.1:0")) == error::operation_failed);
+
+    server->stop();
+    pool.shutdown();
+    pool.join();
+}
+
+TEST_CASE("statistics server  idle connection  closed after timeout", "[statistics server tests]") {
+    threadpool pool("statistics_test", 1);
+    auto const server = make_server(pool, asio::seconds(1));
+
+    ::asio::io_context context;
+    ::asio::ip::tcp::socket idle(context);
+    idle.connect({ ::asio::ip::make_address("127.0.0.1"), server->port() });
+
+    auto const start = std::chrono::steady_clock::now();
+    REQUIRE(read_all(idle).empty());
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(30));
+
+    // The timed out connection no longer counts against the limit.
+    REQUIRE(get(server->port(), "/metrics").find("HTTP/1.1 200 OK\r\n") == 0);
+
+    server->stop();
+    pool.shutdown();
+    pool.join();
+}
+
+TEST_CASE("statistics server  connection limit  excess closed unanswered", "[statistics server tests]") {
+    threadpool pool("statistics_test", 1);
+    auto const server = make_server(pool, asio::seconds(1), 1);
+
+    ::asio::io_context context;
+    ::asio::ip::tcp::socket idle(context);
+    idle.connect({ ::asio::ip::make_address("127.0.0.1"), server->port() });
+
+    // The idle connection holds the only slot until it times out.
+    REQUIRE(get(server->port(), "/metrics").empty());
+    REQUIRE(read_all(idle).empty());
+    REQUIRE(get(server->port(), "/metrics").find("HTTP/1.1 200 OK\r\n") == 0);
+
+    server->stop();
+    pool.shutdown();
+    pool.join();
+}
+
+// End Test Suite
@@ -0,0 +1,51 @@
+// Copyright (c) 2016-2024 Knuth Project developers.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chrono>
+
+#include <test_helpers.hpp>
+
+#include <kth/network.hpp>
+
+using namespace kth;
+using namespace kth::network;
+
+// Start Test Suite: token bucket tests
+
+TEST_CASE("token bucket  zero rate  unlimited", "[token bucket tests]") {
+    token_bucket bucket(0, 0);
+
+    for (size_t count = 0; count < 1000; ++count) {
+        REQUIRE(bucket.consume());
+    }
+}
+
+TEST_CASE("token bucket  burst  exhausted", "[token bucket tests]") {
+    token_bucket bucket(1, 3);
+    auto const now = token_bucket::clock::now();
+    REQUIRE(bucket.consume(now));
+    REQUIRE(bucket.consume(now));
+    REQUIRE(bucket.consume(now));
+    REQUIRE( ! bucket.consume(now));
+}
+
+TEST_CASE("token bucket  elapsed  refills at rate up to burst", "[token bucket tests]") {
+    token_bucket bucket(4, 2);
+    auto const now = token_bucket::clock::now();
+    REQUIRE(bucket.consume(now));
+    REQUIRE(bucket.consume(now));
+    REQUIRE( ! bucket.consume(now));
+
+    // One token per 250ms.
+    REQUIRE(bucket.consume(now + std::chrono::milliseconds(250)));
+    REQUIRE( ! bucket.consume(now + std::chrono::milliseconds(300)));
+
+    // Refill stops at the burst size.
+    auto const later = now + std::chrono::seconds(10);
+    REQUIRE(bucket.consume(later));
+    REQUIRE(bucket.consume(later));
+    REQUIRE( ! bucket.consume(later));
+}
+
+// End Test Suite